@@ -0,0 +1,44 @@
+#version 330 core
+
+// Grid vertex, in quads from the corner of the node
+layout(location = 0) in vec2 aGridPos;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform sampler2D heightMap;
+uniform float heightMapSize;
+uniform vec3 cameraPos;
+uniform float uvScale;
+
+// Per node
+uniform vec2 nodeOffset;
+uniform float nodeScale; // Samples per grid quad
+uniform vec2 morphRange; // Start of the morph, 1 / morph length
+
+out float yPos;
+out vec3 normal;
+out vec2 uv;
+
+float height(vec2 pos) {
+    return textureLod(heightMap, (pos + .5f) / heightMapSize, 0.f).r;
+}
+
+void main() {
+    // Odd vertices slide onto the next coarser grid as the camera moves away, so the node meets its coarser
+    // neighbours without cracks by the time it gets replaced by them
+    vec2 pos = nodeOffset + aGridPos * nodeScale;
+    float distance = length(cameraPos - vec3(pos.x, height(pos), pos.y));
+    float morph = clamp((distance - morphRange.x) * morphRange.y, 0.f, 1.f);
+    vec2 oddOffset = fract(aGridPos * .5f) * 2.f;
+    pos = nodeOffset + (aGridPos - oddOffset * morph) * nodeScale;
+
+    yPos = height(pos);
+    float left = height(pos - vec2(1.f, 0.f));
+    float right = height(pos + vec2(1.f, 0.f));
+    float up = height(pos - vec2(0.f, 1.f));
+    float down = height(pos + vec2(0.f, 1.f));
+    normal = normalize(vec3(left - right, 2.f, up - down));
+    uv = pos * uvScale;
+    gl_Position = projection * view * vec4(pos.x, yPos, pos.y, 1.f);
+}
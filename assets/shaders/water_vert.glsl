@@ -1,8 +1,21 @@
 #version 330 core
 
+#ifdef COMPACT_VERTICES
+layout(location = 0) in float aHeight;
+layout(location = 1) in vec2 aNormal;
+
+uniform int gridSize;
+uniform vec2 heightRange; // Bottom of the range, size of the range
+uniform float uvScale;
+#elif defined(HEIGHT_ONLY_VERTICES)
+uniform samplerBuffer heights;
+uniform int gridSize;
+uniform float uvScale;
+#else
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aUv;
+#endif
 
 uniform mat4 model;
 uniform mat4 view;
@@ -13,10 +26,72 @@ uniform float time;
 out vec3 normal;
 out vec2 uv;
 
+#ifdef COMPACT_VERTICES
+vec3 decodeNormal(vec2 encoded) {
+    vec3 n = vec3(encoded.x, 1.f - abs(encoded.x) - abs(encoded.y), encoded.y);
+    if (n.y < 0.f) {
+        n.xz = (1.f - abs(n.zx)) * sign(n.xz);
+    }
+    return normalize(n);
+}
+#elif defined(HEIGHT_ONLY_VERTICES)
+float heightAt(int x, int z) {
+    return texelFetch(heights, z * gridSize + x).r;
+}
+
+// Face normals of the two triangles in the quad with its top left corner at (x, z)
+vec3 firstTriangle(int x, int z) {
+    float h00 = heightAt(x, z);
+    return vec3(h00 - heightAt(x + 1, z), 1.f, h00 - heightAt(x, z + 1));
+}
+
+vec3 secondTriangle(int x, int z) {
+    float h11 = heightAt(x + 1, z + 1);
+    return vec3(heightAt(x, z + 1) - h11, 1.f, heightAt(x + 1, z) - h11);
+}
+
+// Sums the triangles around the vertex, the same as the normals built on the CPU
+vec3 gridNormal(int x, int z) {
+    int last = gridSize - 1;
+    vec3 n = vec3(0.f);
+    if (z > 0) {
+        if (x > 0) {
+            n += secondTriangle(x - 1, z - 1);
+        }
+        if (x < last) {
+            n += firstTriangle(x, z - 1) + secondTriangle(x, z - 1);
+        }
+    }
+    if (z < last) {
+        if (x > 0) {
+            n += firstTriangle(x - 1, z) + secondTriangle(x - 1, z);
+        }
+        if (x < last) {
+            n += firstTriangle(x, z);
+        }
+    }
+    return normalize(n);
+}
+#endif
+
 void main() {
-    normal = normalize(normalMat * aNormal);
+#ifdef COMPACT_VERTICES
+    vec2 grid = vec2(gl_VertexID % gridSize, gl_VertexID / gridSize);
+    vec3 aPos = vec3(grid.x, heightRange.x + aHeight * heightRange.y, grid.y);
+    vec3 vertexNormal = decodeNormal(aNormal);
+    vec2 aUv = grid * uvScale;
+#elif defined(HEIGHT_ONLY_VERTICES)
+    int x = gl_VertexID % gridSize;
+    int z = gl_VertexID / gridSize;
+    vec3 aPos = vec3(x, heightAt(x, z), z);
+    vec3 vertexNormal = gridNormal(x, z);
+    vec2 aUv = vec2(x, z) * uvScale;
+#else
+    vec3 vertexNormal = aNormal;
+#endif
+    normal = normalize(normalMat * vertexNormal);
     uv = aUv;
     vec3 position = aPos;
     position.y += sin(aPos.x + time + sin(aPos.z)) * .05f;
     gl_Position = projection * view * model * vec4(position, 1.f);
-}
\ No newline at end of file
+}
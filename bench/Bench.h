@@ -0,0 +1,166 @@
+#ifndef PROCGEN_BENCH_H
+#define PROCGEN_BENCH_H
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Small helpers shared by the benchmark executables
+ */
+namespace bench {
+    struct Result {
+        double median; // Milliseconds
+        double min;
+        double max;
+        double mean;
+        double deviation; // Median absolute deviation from the median, which the odd slow run doesn't throw off
+        int repetitions;
+        // Per repetition, only counted where PROCGEN_BENCH_COUNT_ALLOCATIONS is defined
+        double allocations;
+        double allocatedBytes;
+    };
+
+    /**
+     * Heap allocations so far, on any thread. Only counted by benchmarks that define PROCGEN_BENCH_COUNT_ALLOCATIONS
+     * before including this header, which replaces operator new, in the others they stay at zero
+     */
+    inline std::atomic<size_t> &allocationCount() {
+        static std::atomic<size_t> count{0};
+        return count;
+    }
+
+    inline std::atomic<size_t> &allocatedBytes() {
+        static std::atomic<size_t> bytes{0};
+        return bytes;
+    }
+
+    /**
+     * Runs func once to warm up, then times it the given number of times
+     */
+    template<typename F>
+    Result measure(F func, int repetitions) {
+        func();
+
+        repetitions = std::max(repetitions, 1);
+        std::vector<double> times;
+        times.reserve(repetitions);
+        size_t allocations = allocationCount();
+        size_t bytes = allocatedBytes();
+        for (int i = 0; i < repetitions; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            func();
+            auto end = std::chrono::steady_clock::now();
+            times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        allocations = allocationCount() - allocations;
+        bytes = allocatedBytes() - bytes;
+
+        std::sort(times.begin(), times.end());
+        double median = times[times.size() / 2];
+        double total = 0.;
+        std::vector<double> deviations;
+        for (double time : times) {
+            total += time;
+            deviations.push_back(std::abs(time - median));
+        }
+        std::sort(deviations.begin(), deviations.end());
+        return {median, times.front(), times.back(), total / repetitions, deviations[deviations.size() / 2],
+                repetitions, static_cast<double>(allocations) / repetitions, static_cast<double>(bytes) / repetitions};
+    }
+
+    /**
+     * Stops the compiler from optimising away a result
+     */
+    template<typename T>
+    void keep(const T &value) {
+#if defined(__GNUC__)
+        // Tells the compiler the value is read without emitting any instructions
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile T sink;
+        sink = value;
+#endif
+    }
+
+    /**
+     * Collects results to write out as JSON, so runs on different commits can be compared. Each result goes on its own
+     * line, so two files diff result by result
+     */
+    class Report {
+    private:
+        std::vector<std::string> results;
+
+    public:
+        /**
+         * @param name What was measured, written as is so it shouldn't need escaping
+         * @param parameters Name and value of everything swept over for this result
+         */
+        void add(const std::string &name, const std::vector<std::pair<std::string, double>> &parameters,
+                 const Result &result) {
+            std::string json = "{\"name\": \"" + name + "\", \"parameters\": {";
+            for (size_t i = 0; i < parameters.size(); ++i) {
+                json += (i > 0 ? ", \"" : "\"") + parameters[i].first + "\": " + number(parameters[i].second);
+            }
+            json += "}, \"median_ms\": " + number(result.median) + ", \"min_ms\": " + number(result.min) +
+                    ", \"max_ms\": " + number(result.max) + ", \"mean_ms\": " + number(result.mean) +
+                    ", \"deviation_ms\": " + number(result.deviation) + ", \"repetitions\": " +
+                    number(result.repetitions) + ", \"allocations\": " + number(result.allocations) +
+                    ", \"allocated_bytes\": " + number(result.allocatedBytes) + "}";
+            results.push_back(json);
+        }
+
+        /**
+         * @return False if the file couldn't be written
+         */
+        bool write(const std::string &path) const {
+            FILE *file = fopen(path.c_str(), "w");
+            if (!file) {
+                return false;
+            }
+            fprintf(file, "{\"results\": [\n");
+            for (size_t i = 0; i < results.size(); ++i) {
+                fprintf(file, "  %s%s\n", results[i].c_str(), i + 1 < results.size() ? "," : "");
+            }
+            fprintf(file, "]}\n");
+            return fclose(file) == 0;
+        }
+
+        static std::string number(double value) {
+            char text[32];
+            snprintf(text, sizeof(text), "%.10g", value);
+            return text;
+        }
+    };
+}
+
+#ifdef PROCGEN_BENCH_COUNT_ALLOCATIONS
+// Benchmarks are a single source file each, so these only get defined once
+void *operator new(std::size_t size) {
+    bench::allocationCount().fetch_add(1, std::memory_order_relaxed);
+    bench::allocatedBytes().fetch_add(size, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size > 0 ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+#endif
+
+
+#endif //PROCGEN_BENCH_H
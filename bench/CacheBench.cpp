@@ -0,0 +1,46 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include "Bench.h"
+#include "DiamondSquare.h"
+#include "HeightCache.h"
+#include "HeightField.h"
+#include "HeightPipeline.h"
+#include "HydraulicErosion.h"
+
+/**
+ * Times generating diamond-square with erosion against loading the same heights from the height cache, which is what
+ * a second launch of the same world does, and checks they match.
+ * Usage: ProcGenCacheBench [cache directory] [max size] [repetitions]
+ */
+int main(int argc, char **argv) {
+    const char *directory = argc > 1 ? argv[1] : "bench_cache";
+    int maxSize = argc > 2 ? atoi(argv[2]) : 2049;
+    int repetitions = argc > 3 ? atoi(argv[3]) : 5;
+
+    auto pipeline = std::make_shared<HeightPipeline>(std::make_shared<DiamondSquare>(1, 7.f, 1.f));
+    pipeline->addPass(std::make_shared<HydraulicErosion>(1));
+    auto cache = std::make_shared<HeightCache>(directory);
+    CachedGenerator cached(pipeline, cache);
+
+    printf("%8s %15s %14s %10s %10s\n", "size", "generate ms", "cached ms", "speedup", "identical");
+    for (int size = 257; size <= maxSize; size = (size - 1) * 2 + 1) {
+        HeightField generated(size);
+        HeightField loaded(size);
+
+        auto generateTime = bench::measure([&] {
+            pipeline->generate(generated);
+        }, repetitions);
+        // The warm up run misses and stores the heights, every timed run after it hits
+        auto cachedTime = bench::measure([&] {
+            cached.generate(loaded);
+        }, repetitions);
+
+        bool identical = memcmp(generated.getData(), loaded.getData(), generated.getDataSize() * sizeof(float)) == 0;
+        printf("%8d %15.2f %14.3f %9.0fx %10s\n", size, generateTime.median, cachedTime.median,
+               generateTime.median / cachedTime.median, identical ? "yes" : "no");
+    }
+    printf("%u hits, %u misses\n", cache->getHits(), cache->getMisses());
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <cstdio>
+#include <cstdlib>
+#include <ext/matrix_clip_space.hpp>
+#include <ext/matrix_transform.hpp>
+#include <glm.hpp>
+#include <vector>
+#include "Bench.h"
+#include "Frustum.h"
+#include "Random.h"
+
+/**
+ * Compares testing boxes against the frustum one at a time with the batched SIMD test, and checks they agree.
+ * The boxes are chunk sized and scattered around the camera, roughly what a large streamed world looks like.
+ * Usage: ProcGenCullBench [max boxes] [repetitions]
+ */
+int main(int argc, char **argv) {
+    int maxBoxes = argc > 1 ? atoi(argv[1]) : 1000000;
+    int repetitions = argc > 2 ? atoi(argv[2]) : 21;
+
+    auto projection = glm::perspective(glm::radians(90.f), 1.5f, .1f, 1000.f);
+    auto view = glm::lookAt(glm::vec3(0.f, 10.f, 0.f), glm::vec3(1.f, 9.f, .5f), glm::vec3(0.f, 1.f, 0.f));
+    Frustum frustum(projection * view);
+    Random random(1);
+
+    printf("%10s %12s %12s %10s %10s %10s\n", "boxes", "single ms", "batched ms", "speedup", "culled", "mismatches");
+    for (int count = 1000; count <= maxBoxes; count *= 10) {
+        std::vector<BoundingBox> list;
+        BoundingBoxes boxes;
+        for (int i = 0; i < count; ++i) {
+            glm::vec3 min(random.uniform(0, i, -1500.f, 1500.f), random.uniform(1, i, -10.f, 0.f),
+                          random.uniform(2, i, -1500.f, 1500.f));
+            BoundingBox box{min, min + glm::vec3(64.f, random.uniform(3, i, 1.f, 20.f), 64.f)};
+            list.push_back(box);
+            boxes.add(box);
+        }
+
+        std::vector<unsigned char> single(list.size());
+        std::vector<unsigned char> batched;
+        size_t culled = 0;
+        auto singleTime = bench::measure([&] {
+            for (size_t i = 0; i < list.size(); ++i) {
+                single[i] = frustum.isVisible(list[i]) ? 1 : 0;
+            }
+            bench::keep(single.back());
+        }, repetitions);
+        auto batchedTime = bench::measure([&] {
+            culled = frustum.cull(boxes, batched);
+        }, repetitions);
+
+        int mismatches = 0;
+        for (size_t i = 0; i < list.size(); ++i) {
+            mismatches += single[i] != batched[i];
+        }
+
+        printf("%10d %12.3f %12.3f %9.2fx %10zu %10d\n", count, singleTime.median, batchedTime.median,
+               singleTime.median / batchedTime.median, culled, mismatches);
+    }
+    return 0;
+}
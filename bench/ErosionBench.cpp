@@ -0,0 +1,53 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "Bench.h"
+#include "DiamondSquare.h"
+#include "HeightField.h"
+#include "HydraulicErosion.h"
+#include "ThreadPool.h"
+
+/**
+ * Times hydraulic erosion on diamond-square maps and reports droplets per second against
+ * EROSION_TARGET_DROPLETS_PER_SECOND, which is per thread. Each size is eroded twice more from the same heights to
+ * check the result only depends on the seed.
+ * Usage: ProcGenErosionBench [max size] [repetitions] [droplets per sample]
+ */
+int main(int argc, char **argv) {
+    int maxSize = argc > 1 ? atoi(argv[1]) : 1025;
+    int repetitions = argc > 2 ? atoi(argv[2]) : 3;
+    ErosionSettings settings;
+    settings.dropletsPerSample = argc > 3 ? static_cast<float>(atof(argv[3])) : 1.f;
+
+    DiamondSquare diamondSquare(1, 7.f, 1.f);
+    HydraulicErosion erosion(1, settings);
+    unsigned int threads = ThreadPool::global().getThreadCount();
+
+    printf("%u threads, tiles of %d, target %d droplets/s per thread\n", threads, erosion.getTileSize(),
+           EROSION_TARGET_DROPLETS_PER_SECOND);
+    printf("%8s %12s %10s %16s %20s %8s %14s\n", "size", "droplets", "ms", "droplets/s", "droplets/s/thread",
+           "target", "deterministic");
+    for (int size = 257; size <= maxSize; size = (size - 1) * 2 + 1) {
+        HeightField generated(size);
+        diamondSquare.generate(generated);
+        HeightField field(size);
+        size_t bytes = generated.getDataSize() * sizeof(float);
+
+        auto time = bench::measure([&] {
+            memcpy(field.getData(), generated.getData(), bytes);
+            erosion.apply(field, 0, 0);
+        }, repetitions);
+
+        HeightField again(size);
+        memcpy(again.getData(), generated.getData(), bytes);
+        erosion.apply(again, 0, 0);
+        bool deterministic = memcmp(field.getData(), again.getData(), bytes) == 0;
+
+        long long droplets = erosion.getDropletCount(size);
+        double perSecond = static_cast<double>(droplets) / (time.median / 1000.);
+        double perThread = perSecond / threads;
+        printf("%8d %12lld %10.2f %16.0f %20.0f %8s %14s\n", size, droplets, time.median, perSecond, perThread,
+               perThread >= EROSION_TARGET_DROPLETS_PER_SECOND ? "met" : "missed", deterministic ? "yes" : "no");
+    }
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include "Bench.h"
+#include "HeightExpression.h"
+#include "HeightField.h"
+
+/*
+ * The same height function, ridged mountains masked by low frequency noise, domain warped and clamped, written three
+ * ways: as an expression tree, by hand as one loop per batch, and as a tree of virtual nodes called per sample
+ */
+
+namespace {
+    NoiseSettings ridgedSettings() {
+        NoiseSettings settings;
+        settings.mode = NoiseMode::Ridged;
+        settings.octaves = 5;
+        settings.frequency = 1.f / 96.f;
+        settings.amplitude = 1.f;
+        return settings;
+    }
+
+    NoiseSettings maskSettings() {
+        NoiseSettings settings;
+        settings.octaves = 2;
+        settings.frequency = 1.f / 512.f;
+        settings.amplitude = 10.f;
+        return settings;
+    }
+
+    NoiseSettings warpSettings() {
+        NoiseSettings settings;
+        settings.octaves = 3;
+        settings.frequency = 1.f / 64.f;
+        settings.amplitude = 1.f;
+        return settings;
+    }
+
+    const float warpStrength = 12.f;
+    const float minHeight = -4.f;
+    const float maxHeight = 8.f;
+
+    /**
+     * What the expression should compile down to, written out by hand
+     */
+    class HandWritten : public HeightGenerator {
+    private:
+        NoiseGenerator ridged{1, ridgedSettings()};
+        NoiseGenerator mask{2, maskSettings()};
+        NoiseGenerator warpX{3, warpSettings()};
+        NoiseGenerator warpY{4, warpSettings()};
+
+        void batch(const float *x, const float *y, float *out) const {
+            float offsetX[EXPRESSION_BATCH], offsetY[EXPRESSION_BATCH], masks[EXPRESSION_BATCH];
+            warpX.generatePoints(x, y, EXPRESSION_BATCH, offsetX);
+            warpY.generatePoints(x, y, EXPRESSION_BATCH, offsetY);
+            for (int i = 0; i < EXPRESSION_BATCH; ++i) {
+                offsetX[i] = x[i] + offsetX[i] * warpStrength;
+                offsetY[i] = y[i] + offsetY[i] * warpStrength;
+            }
+            ridged.generatePoints(offsetX, offsetY, EXPRESSION_BATCH, out);
+            mask.generatePoints(offsetX, offsetY, EXPRESSION_BATCH, masks);
+            for (int i = 0; i < EXPRESSION_BATCH; ++i) {
+                out[i] = std::min(std::max(out[i] * masks[i], minHeight), maxHeight);
+            }
+        }
+
+    public:
+        void generate(HeightField &field, int originX, int originY) const override {
+            int size = field.getSize();
+            float pointX[EXPRESSION_BATCH], pointY[EXPRESSION_BATCH], heights[EXPRESSION_BATCH];
+            for (int y = 0; y < size; ++y) {
+                std::fill(pointY, pointY + EXPRESSION_BATCH, static_cast<float>(originY + y));
+                for (int start = 0; start < size; start += EXPRESSION_BATCH) {
+                    for (int i = 0; i < EXPRESSION_BATCH; ++i) {
+                        pointX[i] = static_cast<float>(originX + start + i);
+                    }
+                    batch(pointX, pointY, heights);
+                    std::copy(heights, heights + std::min(EXPRESSION_BATCH, size - start), field.row(y) + start);
+                }
+            }
+        }
+
+        float getHeightScale() const override {
+            return maxHeight;
+        }
+
+        void hash(Hasher &hasher) const override {
+            hasher.add("HandWritten");
+        }
+    };
+
+    /**
+     * The obvious runtime composable version, one virtual call per node per sample
+     */
+    struct Node {
+        virtual ~Node() = default;
+
+        virtual float sample(float x, float y) const = 0;
+    };
+
+    struct FractalNode : Node {
+        NoiseGenerator generator;
+
+        FractalNode(unsigned int seed, const NoiseSettings &settings) : generator(seed, settings) {}
+
+        float sample(float x, float y) const override {
+            float height;
+            generator.generatePoints(&x, &y, 1, &height);
+            return height;
+        }
+    };
+
+    struct MulNode : Node {
+        std::unique_ptr<Node> a, b;
+
+        MulNode(Node *a, Node *b) : a(a), b(b) {}
+
+        float sample(float x, float y) const override {
+            return a->sample(x, y) * b->sample(x, y);
+        }
+    };
+
+    struct WarpNode : Node {
+        std::unique_ptr<Node> source, warpX, warpY;
+        float strength;
+
+        WarpNode(Node *source, Node *warpX, Node *warpY, float strength)
+                : source(source), warpX(warpX), warpY(warpY), strength(strength) {}
+
+        float sample(float x, float y) const override {
+            return source->sample(x + warpX->sample(x, y) * strength, y + warpY->sample(x, y) * strength);
+        }
+    };
+
+    struct ClampNode : Node {
+        std::unique_ptr<Node> a;
+        float min, max;
+
+        ClampNode(Node *a, float min, float max) : a(a), min(min), max(max) {}
+
+        float sample(float x, float y) const override {
+            return std::min(std::max(a->sample(x, y), min), max);
+        }
+    };
+}
+
+/**
+ * Compares the expression tree against the hand-written loop and the virtual node tree, single threaded, and checks
+ * they all agree.
+ * Usage: ProcGenExpressionBench [max size] [repetitions]
+ */
+int main(int argc, char **argv) {
+    int maxSize = argc > 1 ? atoi(argv[1]) : 1025;
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+
+    auto expression = expr::clamp(expr::warp(expr::fractal(1, ridgedSettings()) * expr::fractal(2, maskSettings()),
+                                             expr::fractal(3, warpSettings()), expr::fractal(4, warpSettings()),
+                                             warpStrength), minHeight, maxHeight);
+    auto expressionGenerator = expr::makeGenerator(expression, maxHeight);
+    HandWritten handWritten;
+    ClampNode nodes(new WarpNode(new MulNode(new FractalNode(1, ridgedSettings()), new FractalNode(2, maskSettings())),
+                                 new FractalNode(3, warpSettings()), new FractalNode(4, warpSettings()),
+                                 warpStrength), minHeight, maxHeight);
+
+    printf("%8s %16s %14s %12s %12s %12s\n", "size", "hand-written ms", "expression ms", "virtual ms",
+           "expr diff", "virtual diff");
+    for (int size = 129; size <= maxSize; size = (size - 1) * 2 + 1) {
+        HeightField handField(size), expressionField(size), nodeField(size);
+
+        auto handTime = bench::measure([&] {
+            handWritten.generate(handField, 0, 0);
+        }, repetitions);
+        auto expressionTime = bench::measure([&] {
+            for (int y = 0; y < size; ++y) {
+                expressionGenerator->generateRow(0, y, size, expressionField.row(y));
+            }
+        }, repetitions);
+        auto nodeTime = bench::measure([&] {
+            for (int y = 0; y < size; ++y) {
+                for (int x = 0; x < size; ++x) {
+                    nodeField.at(x, y) = nodes.sample(static_cast<float>(x), static_cast<float>(y));
+                }
+            }
+        }, repetitions);
+
+        float expressionDifference = 0.f, nodeDifference = 0.f;
+        handField.forEach([&](int x, int y, float height) {
+            expressionDifference = std::max(expressionDifference, std::abs(expressionField.at(x, y) - height));
+            nodeDifference = std::max(nodeDifference, std::abs(nodeField.at(x, y) - height));
+        });
+
+        printf("%8d %16.2f %14.2f %12.2f %12g %12g\n", size, handTime.median, expressionTime.median,
+               nodeTime.median, expressionDifference, nodeDifference);
+    }
+    return 0;
+}
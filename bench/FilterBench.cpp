@@ -0,0 +1,93 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "Bench.h"
+#include "DiamondSquare.h"
+#include "HeightField.h"
+#include "HeightFilters.h"
+
+/**
+ * Times a filter chain (4 thermal erosion iterations, a blur, terracing and a clamp) run fused over cache sized tiles
+ * against running each filter over the whole field in turn, with the scalar and SIMD kernels. All three have to give
+ * the same heights.
+ * Usage: ProcGenFilterBench [max size] [repetitions]
+ */
+namespace {
+    const int thermalIterations = 4;
+
+    void addThermal(FilterChain &chain) {
+        chain.addThermal(1, .3f);
+    }
+
+    void addBlur(FilterChain &chain) {
+        chain.addBlur(1.f);
+    }
+
+    void addTerrace(FilterChain &chain) {
+        chain.addTerrace(1.f, .4f);
+    }
+
+    void addClamp(FilterChain &chain) {
+        chain.addClamp(-4.f, 10.f);
+    }
+}
+
+int main(int argc, char **argv) {
+    int maxSize = argc > 1 ? atoi(argv[1]) : 4097;
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+
+    FilterChain scalarFused;
+    FilterChain fused;
+    scalarFused.setKernels(filter::scalar());
+    for (auto chain : {&scalarFused, &fused}) {
+        for (int i = 0; i < thermalIterations; ++i) {
+            addThermal(*chain);
+        }
+        addBlur(*chain);
+        addTerrace(*chain);
+        addClamp(*chain);
+    }
+    // The same filters one chain each, so every filter is a separate pass over the whole field
+    std::vector<FilterChain> separate(thermalIterations + 3);
+    for (int i = 0; i < thermalIterations; ++i) {
+        addThermal(separate[i]);
+    }
+    addBlur(separate[thermalIterations]);
+    addTerrace(separate[thermalIterations + 1]);
+    addClamp(separate[thermalIterations + 2]);
+
+    DiamondSquare diamondSquare(1, 7.f, 1.f);
+    printf("using %s kernels, %zu filters, halo %d\n", filter::best().name, separate.size(), fused.getHalo());
+    printf("%8s %14s %16s %14s %10s %10s\n", "size", "separate ms", "scalar fused ms", "simd fused ms", "speedup",
+           "identical");
+    for (int size = 1025; size <= maxSize; size = (size - 1) * 2 + 1) {
+        HeightField generated(size);
+        diamondSquare.generate(generated);
+        size_t bytes = generated.getDataSize() * sizeof(float);
+        HeightField separateField(size);
+        HeightField scalarField(size);
+        HeightField fusedField(size);
+
+        auto separateTime = bench::measure([&] {
+            memcpy(separateField.getData(), generated.getData(), bytes);
+            for (const auto &chain : separate) {
+                chain.apply(separateField, 0, 0);
+            }
+        }, repetitions);
+        auto scalarTime = bench::measure([&] {
+            memcpy(scalarField.getData(), generated.getData(), bytes);
+            scalarFused.apply(scalarField, 0, 0);
+        }, repetitions);
+        auto fusedTime = bench::measure([&] {
+            memcpy(fusedField.getData(), generated.getData(), bytes);
+            fused.apply(fusedField, 0, 0);
+        }, repetitions);
+
+        bool identical = memcmp(separateField.getData(), fusedField.getData(), bytes) == 0 &&
+                         memcmp(scalarField.getData(), fusedField.getData(), bytes) == 0;
+        printf("%8d %14.2f %16.2f %14.2f %9.2fx %10s\n", size, separateTime.median, scalarTime.median,
+               fusedTime.median, separateTime.median / fusedTime.median, identical ? "yes" : "no");
+    }
+    return 0;
+}
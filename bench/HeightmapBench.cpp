@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include "Bench.h"
+#include "DiamondSquare.h"
+#include "HeightField.h"
+#include "Random.h"
+#include "TiledHeightmap.h"
+
+/**
+ * Writes a tiled heightmap from seamless diamond-square, then streams chunks out of it at random like a camera flying
+ * around would. Reports how fast chunks come out of the file and how much of it stays resident, and checks the heights
+ * and the mip levels against the generator.
+ * Usage: ProcGenHeightmapBench [path] [size] [tile budget] [chunks]
+ */
+namespace {
+    /**
+     * Resident set size in MB, where the OS makes it easy to find
+     */
+    double residentMegabytes() {
+#ifdef __linux__
+        std::ifstream statm("/proc/self/statm");
+        double pages = 0., resident = 0.;
+        statm >> pages >> resident;
+        return resident * 4096. / (1024. * 1024.);
+#else
+        return 0.;
+#endif
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "bench_heightmap.pgtm";
+    unsigned int size = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 8193;
+    int budget = argc > 3 ? atoi(argv[3]) : 64;
+    int chunks = argc > 4 ? atoi(argv[4]) : 2000;
+    const int chunkSize = 65;
+    const unsigned int tileSize = 256;
+
+    DiamondSquare diamondSquare(1, 7.f, 1.f);
+    diamondSquare.setEdgeMode(EdgeMode::Seamless);
+    float minY = -diamondSquare.getHeightScale() * 2.f, maxY = diamondSquare.getHeightScale() * 2.f;
+    // Only written once, it's far too slow to repeat
+    auto start = std::chrono::steady_clock::now();
+    if (!TiledHeightmap::create(path, size, tileSize, minY, maxY, diamondSquare)) {
+        return 1;
+    }
+    double createTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    auto heightmap = std::make_shared<TiledHeightmap>(path);
+    if (!heightmap->isOpen()) {
+        return 1;
+    }
+    heightmap->setTileBudget(budget);
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    printf("%ux%u, %u levels, tiles of %u, %.1f MB file, written in %.0f ms\n", size, size, heightmap->getLevels(),
+           tileSize, static_cast<double>(file.tellg()) / (1024. * 1024.), createTime);
+
+    // Check a few chunks against the generator, they should only be off by the 16 bit quantisation
+    float maxError = 0.f;
+    Random random(2);
+    int chunkRange = static_cast<int>((size - 1) / (chunkSize - 1));
+    for (int i = 0; i < 16; ++i) {
+        int originX = static_cast<int>(random.next(0, i) % chunkRange) * (chunkSize - 1);
+        int originY = static_cast<int>(random.next(1, i) % chunkRange) * (chunkSize - 1);
+        HeightField generated(chunkSize);
+        HeightField loaded(chunkSize);
+        // Tiles were generated on a 256 grid, a chunk only matches when it sits inside one
+        int tileX = originX / static_cast<int>(tileSize) * static_cast<int>(tileSize);
+        int tileY = originY / static_cast<int>(tileSize) * static_cast<int>(tileSize);
+        HeightField tile(tileSize + 1);
+        diamondSquare.generate(tile, tileX, tileY);
+        heightmap->read(0, originX, originY, loaded);
+        for (int y = 0; y < chunkSize && originY + y <= tileY + static_cast<int>(tileSize); ++y) {
+            for (int x = 0; x < chunkSize && originX + x <= tileX + static_cast<int>(tileSize); ++x) {
+                float expected = tile.at(originX - tileX + x, originY - tileY + y);
+                maxError = std::max(maxError, std::abs(loaded.at(x, y) - expected));
+            }
+        }
+    }
+    int levelMismatches = 0;
+    for (unsigned int level = 1; level < heightmap->getLevels(); ++level) {
+        for (int i = 0; i < 1000; ++i) {
+            int x = static_cast<int>(random.next(2, i) % heightmap->getSize(level));
+            int y = static_cast<int>(random.next(3, i) % heightmap->getSize(level));
+            levelMismatches += heightmap->sample(level, x, y) != heightmap->sample(0, x << level, y << level);
+        }
+    }
+    printf("max error %.5f (quantisation step %.5f), %d level mismatches\n", maxError, (maxY - minY) / 65535.f,
+           levelMismatches);
+
+    printf("%6s %10s %14s %16s %12s\n", "level", "chunks", "chunks/s", "resident tiles", "resident MB");
+    for (unsigned int level = 0; level < heightmap->getLevels() && heightmap->getSize(level) > chunkSize; ++level) {
+        int range = static_cast<int>((heightmap->getSize(level) - 1) / (chunkSize - 1));
+        HeightField field(chunkSize);
+        auto readTime = bench::measure([&] {
+            for (int i = 0; i < chunks; ++i) {
+                int originX = static_cast<int>(random.next(4, i) % range) * (chunkSize - 1);
+                int originY = static_cast<int>(random.next(5, i) % range) * (chunkSize - 1);
+                heightmap->read(static_cast<int>(level), originX, originY, field);
+            }
+        }, 3);
+        printf("%6u %10d %14.0f %16zu %12.1f\n", level, chunks, chunks / (readTime.median / 1000.),
+               heightmap->getResidentTiles(), residentMegabytes());
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "IndexBuilder.h"
+
+/**
+ * Reports how many vertex shader runs each index order costs per triangle (ACMR) and per vertex (ATVR) on a grid,
+ * using a simulated FIFO post-transform cache.
+ * Usage: ProcGenIndexReport [map size] [cache size]
+ */
+int main(int argc, char **argv) {
+    unsigned int size = argc > 1 ? static_cast<unsigned int>(atoi(argv[1])) : 1025;
+    unsigned int cacheSize = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : VERTEX_CACHE_SIZE;
+    size_t vertexCount = static_cast<size_t>(size) * size;
+
+    const IndexOrder orders[] = {IndexOrder::RowStrips, IndexOrder::ColumnBands, IndexOrder::Forsyth};
+    const char *orderNames[] = {"row strips", "column bands", "forsyth"};
+
+    printf("%u x %u grid, %u entry FIFO cache\n", size, size, cacheSize);
+    if (indexBuilder::fitsMeshlets(size)) {
+        printf("16 bit meshlets of %u quad rows\n", indexBuilder::meshletQuadRows(size));
+    } else {
+        printf("Too wide for 16 bit meshlets, drawn with 32 bit indices\n");
+    }
+    printf("%14s %10s %10s %12s %12s\n", "order", "ACMR", "ATVR", "indices", "build ms");
+    for (int i = 0; i < 3; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        auto indices = indexBuilder::buildGrid<unsigned int>(size, size - 1, orders[i]);
+        auto end = std::chrono::steady_clock::now();
+
+        auto stats = indexBuilder::measureVertexCache(indices, orders[i] == IndexOrder::RowStrips, vertexCount,
+                                                      cacheSize);
+        printf("%14s %10.3f %10.3f %12zu %12.1f\n", orderNames[i], stats.acmr, stats.atvr, indices.size(),
+               std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <cstdio>
+#include <cstdlib>
+#include "Bench.h"
+#include "DiamondSquare.h"
+#include "HeightField.h"
+
+/**
+ * Compares the row major and tiled height field layouts.
+ * Usage: ProcGenLayoutBench [max size] [repetitions]
+ */
+int main(int argc, char **argv) {
+    int maxSize = argc > 1 ? atoi(argv[1]) : 16385;
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+
+    const HeightLayout layouts[] = {HeightLayout::RowMajor, HeightLayout::Tiled};
+    const char *layoutNames[] = {"row major", "tiled"};
+
+    printf("%8s %10s %14s %14s %14s\n", "size", "layout", "generate ms", "neighbours ms", "coarse ms");
+    for (int size = 257; size <= maxSize; size = (size - 1) * 2 + 1) {
+        for (int i = 0; i < 2; ++i) {
+            HeightField field(size, layouts[i]);
+            DiamondSquare generator(1, 7.f, 1.f);
+
+            auto generate = bench::measure([&] {
+                generator.generate(field);
+            }, repetitions);
+
+            // Same access pattern as building normals, every sample and its four neighbours
+            auto neighbours = bench::measure([&] {
+                float total = 0.f;
+                field.forEachIn(1, 1, size - 1, size - 1, [&](int x, int y, float height) {
+                    total += field.at(x - 1, y) + field.at(x + 1, y) + field.at(x, y - 1) + field.at(x, y + 1) -
+                             4.f * height;
+                });
+                bench::keep(total);
+            }, repetitions);
+
+            // Corner reads of the coarse diamond-square levels, the case the tiled layout is meant for
+            auto coarse = bench::measure([&] {
+                float total = 0.f;
+                for (int step = size - 1; step >= 16; step /= 2) {
+                    for (int y = 0; y < size; y += step) {
+                        for (int x = 0; x < size; x += step) {
+                            total += field.at(x, y);
+                        }
+                    }
+                }
+                bench::keep(total);
+            }, repetitions);
+
+            printf("%8d %10s %14.2f %14.2f %14.2f\n", size, layoutNames[i], generate.median, neighbours.median,
+                   coarse.median);
+        }
+    }
+    return 0;
+}
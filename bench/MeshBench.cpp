@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <glm.hpp>
+#include <vector>
+#include "Bench.h"
+#include "DiamondSquare.h"
+#include "HeightField.h"
+#include "TerrainMesh.h"
+
+#define TEX_SCALE .75f
+
+/**
+ * The vertex building Terrain used before terrainMesh::buildVertices: separate passes for positions and UVs, face
+ * normals per quad and then accumulating them per vertex. The quad normals are on the heap here, on the stack they
+ * overflow long before the larger sizes
+ */
+void buildVerticesSeparatePasses(const HeightField &field, Vertex *vertices, float &minY, float &maxY) {
+    int size = static_cast<int>(field.getSize());
+    auto vertex = [&](int x, int y) -> Vertex & {
+        return vertices[size * y + x];
+    };
+
+    field.getRange(minY, maxY);
+    float uScale = static_cast<float>(size) * TEX_SCALE;
+    float vScale = static_cast<float>(size) * TEX_SCALE;
+    field.forEach([&](int x, int y, float height) {
+        vertex(x, y).position = glm::vec3(x, height, y);
+        vertex(x, y).uv.x = uScale * (static_cast<float>(x) / static_cast<float>(size - 1));
+        vertex(x, y).uv.y = vScale * (static_cast<float>(y) / static_cast<float>(size - 1));
+    });
+
+    std::vector<glm::vec3> quadNormals(static_cast<size_t>(size - 1) * (size - 1) * 2);
+    auto quadNormal = [&](int x, int y, int triangle) -> glm::vec3 & {
+        return quadNormals[(static_cast<size_t>(x) * (size - 1) + y) * 2 + triangle];
+    };
+
+    for (int x = 0; x < size - 1; ++x) {
+        for (int y = 0; y < size - 1; ++y) {
+            auto vert1 = vertex(x, y).position;
+            auto vert2 = vertex(x, y + 1).position;
+            auto vert3 = vertex(x + 1, y).position;
+
+            auto normal = glm::cross(vert1 - vert2, vert1 - vert3);
+            normal += glm::cross(vert2 - vert3, vert2 - vert1);
+            normal += glm::cross(vert3 - vert1, vert3 - vert2);
+            quadNormal(x, y, 0) = normal;
+
+            vert1 = vertex(x + 1, y + 1).position;
+            vert2 = vertex(x + 1, y).position;
+            vert3 = vertex(x, y + 1).position;
+
+            normal = glm::cross(vert1 - vert2, vert1 - vert3);
+            normal += glm::cross(vert2 - vert3, vert2 - vert1);
+            normal += glm::cross(vert3 - vert1, vert3 - vert2);
+            quadNormal(x, y, 1) = normal;
+        }
+    }
+
+    for (int x = 0; x < size; ++x) {
+        for (int y = 0; y < size; ++y) {
+            glm::vec3 normal(0.f);
+            if (y > 0) {
+                if (x > 0) {
+                    normal += quadNormal(x - 1, y - 1, 1);
+                }
+                if (x < size - 1) {
+                    normal += quadNormal(x, y - 1, 0);
+                    normal += quadNormal(x, y - 1, 1);
+                }
+            }
+            if (y < size - 1) {
+                if (x > 0) {
+                    normal += quadNormal(x - 1, y, 0);
+                    normal += quadNormal(x - 1, y, 1);
+                }
+                if (x < size - 1) {
+                    normal += quadNormal(x, y, 0);
+                }
+            }
+            vertex(x, y).normal = glm::normalize(normal);
+        }
+    }
+}
+
+/**
+ * Compares the fused vertex pass against the old separate passes, and checks they agree.
+ * Usage: ProcGenMeshBench [max size] [repetitions]
+ */
+int main(int argc, char **argv) {
+    int maxSize = argc > 1 ? atoi(argv[1]) : 4097;
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+
+    printf("%8s %14s %14s %10s %16s\n", "size", "separate ms", "fused ms", "speedup", "max normal diff");
+    for (int size = 257; size <= maxSize; size = (size - 1) * 2 + 1) {
+        HeightField field(size);
+        DiamondSquare(1, 7.f, 1.f).generate(field);
+        std::vector<Vertex> separate(static_cast<size_t>(size) * size);
+        std::vector<Vertex> fused(separate.size());
+        float minY, maxY;
+
+        auto separateTime = bench::measure([&] {
+            buildVerticesSeparatePasses(field, separate.data(), minY, maxY);
+        }, repetitions);
+        auto fusedTime = bench::measure([&] {
+            terrainMesh::buildVertices(field, TEX_SCALE, fused.data(), minY, maxY);
+        }, repetitions);
+
+        float difference = 0.f;
+        for (size_t i = 0; i < separate.size(); ++i) {
+            difference = std::max(difference, glm::length(separate[i].normal - fused[i].normal));
+        }
+
+        printf("%8d %14.2f %14.2f %9.2fx %16g\n", size, separateTime.median, fusedTime.median,
+               separateTime.median / fusedTime.median, difference);
+    }
+    return 0;
+}
@@ -0,0 +1,163 @@
+#define PROCGEN_BENCH_COUNT_ALLOCATIONS
+#define STB_IMAGE_IMPLEMENTATION
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <stb_image.h>
+#include "Bench.h"
+#include "DiamondSquare.h"
+#include "HeightField.h"
+#include "TerrainMesh.h"
+#include "ThreadPool.h"
+#include "TreeSkeleton.h"
+
+#define TEX_SCALE .75f
+
+/**
+ * Times the generation and mesh building hot paths on their own, each swept over what it depends on: diamond-square
+ * over map size and thread count, the CPU side of Terrain::buildBuffers over map size, tree growth over attraction
+ * points and influence radius, and decoding the terrain textures the way loadTexture does.
+ * Every result is the median of the repetitions after a warm up, with the median absolute deviation to show how steady
+ * it was and the heap allocations per repetition. Results are printed and written as JSON to compare across commits.
+ * Run from the repository root so the textures are found.
+ * Usage: ProcGenMicroBench [json path] [repetitions] [max size]
+ */
+namespace {
+    bench::Report report;
+
+    void record(const std::string &name, const std::vector<std::pair<std::string, double>> &parameters,
+                const bench::Result &result) {
+        std::string description;
+        for (auto &parameter : parameters) {
+            description += parameter.first + "=" + bench::Report::number(parameter.second) + " ";
+        }
+        printf("%-16s %-32s %10.3f %10.3f %12.0f %14.0f\n", name.c_str(), description.c_str(), result.median,
+               result.deviation, result.allocations, result.allocatedBytes);
+        report.add(name, parameters, result);
+    }
+
+    void diamondSquare(int maxSize, int repetitions) {
+        auto &pool = ThreadPool::global();
+        unsigned int maxThreads = pool.getThreadCount();
+        std::vector<unsigned int> threadCounts;
+        for (unsigned int threads = 1; threads < maxThreads; threads *= 2) {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(maxThreads);
+
+        DiamondSquare generator(1, 7.f, 1.f);
+        for (int size = 129; size <= maxSize; size = (size - 1) * 2 + 1) {
+            HeightField field(size);
+            for (unsigned int threads : threadCounts) {
+                pool.setThreadLimit(threads);
+                auto result = bench::measure([&] {
+                    generator.generate(field);
+                    bench::keep(field.at(size / 2, size / 2));
+                }, repetitions);
+                record("diamondSquare", {{"size", size}, {"threads", threads}}, result);
+            }
+        }
+        pool.setThreadLimit(0);
+    }
+
+    void buildVertices(int maxSize, int repetitions) {
+        DiamondSquare generator(1, 7.f, 1.f);
+        for (int size = 129; size <= maxSize; size = (size - 1) * 2 + 1) {
+            HeightField field(size);
+            generator.generate(field);
+            int fieldSize = size;
+            std::vector<Vertex> vertices(static_cast<size_t>(size) * size);
+            std::vector<CompactVertex> compactVertices(vertices.size());
+            float minY, maxY;
+            auto result = bench::measure([&] {
+                terrainMesh::buildVertices(field, TEX_SCALE, vertices.data(), minY, maxY);
+                bench::keep(vertices.back().normal.y);
+            }, repetitions);
+            record("buildVertices", {{"size", size}}, result);
+
+            result = bench::measure([&] {
+                terrainMesh::buildCompactVertices(field, {0, 0, fieldSize, fieldSize}, minY, maxY,
+                                                  compactVertices.data());
+                bench::keep(compactVertices.back().height);
+            }, repetitions);
+            record("buildCompact", {{"size", size}}, result);
+        }
+    }
+
+    void growTrees(int repetitions) {
+        for (unsigned int points : {250u, 500u, 1000u, 2000u}) {
+            for (float radius : {1.f, 2.f, 4.f}) {
+                TreeSettings settings{};
+                settings.attractionPoints = points;
+                settings.influenceRadius = radius;
+                settings.killDistance = .5f;
+                settings.crownCentre = glm::vec3(0.f, 2.5f, 0.f);
+                settings.crownSize = glm::vec3(2.f, 5.f, 2.f);
+                settings.nodeSize = .25f;
+                settings.seed = 322;
+                auto result = bench::measure([&] {
+                    TreeSkeleton skeleton(settings, glm::vec3(0.f));
+                    bench::keep(skeleton.getNodes().size());
+                }, repetitions);
+                record("treeGrow", {{"points", points}, {"radius", radius}}, result);
+            }
+        }
+    }
+
+    /**
+     * Only the decode, the file is read beforehand and nothing is uploaded. stb allocates with malloc, which isn't
+     * counted, so these show no allocations
+     */
+    void decodeTextures(int repetitions) {
+        for (const char *path : {"assets/textures/sand.jpg", "assets/textures/grass.jpg",
+                                 "assets/textures/water.jpg"}) {
+            std::ifstream file(path, std::ios::binary);
+            std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (data.empty()) {
+                fprintf(stderr, "Couldn't read %s, run from the repository root\n", path);
+                continue;
+            }
+            // Decoded once up front, so a file stb can't read is skipped rather than timed
+            int width = 0, height = 0, channels = 0;
+            auto imageData = stbi_load_from_memory(data.data(), static_cast<int>(data.size()), &width, &height,
+                                                   &channels, 4);
+            if (!imageData) {
+                fprintf(stderr, "Couldn't decode %s: %s\n", path, stbi_failure_reason());
+                continue;
+            }
+            stbi_image_free(imageData);
+            auto result = bench::measure([&] {
+                auto pixels = stbi_load_from_memory(data.data(), static_cast<int>(data.size()), &width, &height,
+                                                    &channels, 4);
+                bench::keep(pixels);
+                stbi_image_free(pixels);
+            }, repetitions);
+            record("decodeTexture", {{"fileBytes", static_cast<double>(data.size())},
+                                     {"pixels", static_cast<double>(width) * height}}, result);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "micro_bench.json";
+    int repetitions = argc > 2 ? atoi(argv[2]) : 15;
+    int maxSize = argc > 3 ? atoi(argv[3]) : 2049;
+
+    printf("%-16s %-32s %10s %10s %12s %14s\n", "benchmark", "parameters", "median ms", "deviation", "allocations",
+           "bytes");
+    diamondSquare(maxSize, repetitions);
+    buildVertices(maxSize, repetitions);
+    growTrees(repetitions);
+    decodeTextures(repetitions);
+
+    if (!report.write(path)) {
+        fprintf(stderr, "Couldn't write %s\n", path);
+        return 1;
+    }
+    printf("Results written to %s\n", path);
+    return 0;
+}
@@ -0,0 +1,49 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "Bench.h"
+#include "DiamondSquare.h"
+#include "HeightField.h"
+#include "NoiseGenerator.h"
+
+/**
+ * Times fractal noise generation with the scalar and SIMD kernels against diamond-square, and checks the kernels
+ * agree. Noise does several octaves of work per sample, diamond-square about one, so the comparison that matters is
+ * how much of that gap the SIMD kernels close.
+ * Usage: ProcGenNoiseBench [max size] [repetitions]
+ */
+int main(int argc, char **argv) {
+    int maxSize = argc > 1 ? atoi(argv[1]) : 4097;
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+
+    NoiseSettings settings;
+    NoiseGenerator scalarNoise(1, settings);
+    scalarNoise.setKernels(noise::scalar());
+    NoiseGenerator bestNoise(1, settings);
+    DiamondSquare diamondSquare(1, 7.f, 1.f);
+
+    printf("using %s kernels, %d octaves\n", noise::best().name, settings.octaves);
+    printf("%8s %16s %14s %10s %18s %10s\n", "size", "scalar noise ms", "simd noise ms", "speedup",
+           "diamond-square ms", "identical");
+    for (int size = 257; size <= maxSize; size = (size - 1) * 2 + 1) {
+        HeightField scalarField(size);
+        HeightField bestField(size);
+        HeightField diamondSquareField(size);
+
+        auto scalarTime = bench::measure([&] {
+            scalarNoise.generate(scalarField);
+        }, repetitions);
+        auto bestTime = bench::measure([&] {
+            bestNoise.generate(bestField);
+        }, repetitions);
+        auto diamondSquareTime = bench::measure([&] {
+            diamondSquare.generate(diamondSquareField);
+        }, repetitions);
+
+        size_t bytes = scalarField.getDataSize() * sizeof(float);
+        bool identical = memcmp(scalarField.getData(), bestField.getData(), bytes) == 0;
+        printf("%8d %16.2f %14.2f %9.2fx %18.2f %10s\n", size, scalarTime.median, bestTime.median,
+               scalarTime.median / bestTime.median, diamondSquareTime.median, identical ? "yes" : "no");
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <glm.hpp>
+#include <vector>
+#include "DiamondSquare.h"
+#include "HeightField.h"
+#include "TerrainMesh.h"
+
+/**
+ * Undoes the octahedral encoding, the same way the vertex shader does
+ */
+template<typename N>
+glm::vec3 decodeNormal(const N *encoded) {
+    const float normalMax = static_cast<float>((1 << (sizeof(N) * 8 - 1)) - 1);
+    glm::vec3 normal(encoded[0] / normalMax, 0.f, encoded[1] / normalMax);
+    normal.y = 1.f - std::abs(normal.x) - std::abs(normal.z);
+    if (normal.y < 0.f) {
+        float x = normal.x;
+        normal.x = (1.f - std::abs(normal.z)) * (normal.x >= 0.f ? 1.f : -1.f);
+        normal.z = (1.f - std::abs(x)) * (normal.z >= 0.f ? 1.f : -1.f);
+    }
+    return glm::normalize(normal);
+}
+
+/**
+ * Packs the vertices and prints the buffer size and how much precision was lost
+ */
+template<typename N>
+void report(const char *name, const std::vector<Vertex> &vertices, float minY, float maxY) {
+    std::vector<PackedVertex<N>> packed(vertices.size());
+    terrainMesh::packVertices(vertices.data(), vertices.size(), minY, maxY, packed.data());
+
+    float heightError = 0.f;
+    float angleError = 0.f;
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        float height = minY + packed[i].height / 65535.f * (maxY - minY);
+        heightError = std::max(heightError, std::abs(height - vertices[i].position.y));
+        float cosine = glm::dot(decodeNormal(packed[i].normal), vertices[i].normal);
+        angleError = std::max(angleError, glm::degrees(std::acos(std::min(cosine, 1.f))));
+    }
+
+    double megabytes = static_cast<double>(packed.size() * sizeof(PackedVertex<N>)) / (1024. * 1024.);
+    printf("%10s %12zu %12.2f %9.1fx %14g %14g\n", name, sizeof(PackedVertex<N>), megabytes,
+           static_cast<double>(sizeof(Vertex)) / sizeof(PackedVertex<N>), heightError, angleError);
+}
+
+/**
+ * Compares the memory used by the full and compact terrain vertex formats, and the precision the compact ones lose.
+ * Vertex fetch bandwidth scales the same way as the buffer size, every vertex is read once per draw.
+ * Usage: ProcGenVertexFormatReport [max size]
+ */
+int main(int argc, char **argv) {
+    int maxSize = argc > 1 ? atoi(argv[1]) : 4097;
+
+    for (int size = 257; size <= maxSize; size = (size - 1) * 2 + 1) {
+        HeightField field(size);
+        DiamondSquare(1, 7.f, 1.f).generate(field);
+        std::vector<Vertex> vertices(static_cast<size_t>(size) * size);
+        float minY, maxY;
+        terrainMesh::buildVertices(field, 1.f, vertices.data(), minY, maxY);
+
+        printf("%d x %d\n", size, size);
+        printf("%10s %12s %12s %10s %14s %14s\n", "format", "bytes/vert", "VBO MB", "smaller", "max height err",
+               "max normal deg");
+        printf("%10s %12zu %12.2f %9.1fx %14g %14g\n", "full", sizeof(Vertex),
+               static_cast<double>(vertices.size() * sizeof(Vertex)) / (1024. * 1024.), 1., 0., 0.);
+        report<signed char>("compact8", vertices, minY, maxY);
+        report<short>("compact16", vertices, minY, maxY);
+        // Height only vertices are the heights as they are, the shader rebuilds the normals exactly
+        printf("%10s %12zu %12.2f %9.1fx %14g %14g\n", "heights", sizeof(float),
+               static_cast<double>(vertices.size() * sizeof(float)) / (1024. * 1024.),
+               static_cast<double>(sizeof(Vertex)) / sizeof(float), 0., 0.);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include "DiamondSquare.h"
+#include "HeightField.h"
+#include "Random.h"
+#include "TiledDiamondSquare.h"
+#include "TiledHeightmap.h"
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+/**
+ * Writes a tiled diamond-square world straight to a heightmap file a tile at a time, e.g. 65537 x 65537 which would
+ * need 16 GB as floats. Reports how fast samples go out and the peak memory used, and checks the cells meet their
+ * neighbours, the coarse grid matches diamond-square over a whole world, and the file matches the generator.
+ * Usage: ProcGenWorldBench [path] [size] [cell size]
+ */
+namespace {
+    /**
+     * Peak resident set size in MB, where the OS makes it easy to find
+     */
+    double peakMegabytes() {
+#ifdef __unix__
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return static_cast<double>(usage.ru_maxrss) / 1024.;
+#else
+        return 0.;
+#endif
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "bench_world.pgtm";
+    unsigned int size = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 16385;
+    unsigned int cellSize = argc > 3 ? static_cast<unsigned int>(atoi(argv[3])) : 256;
+
+    auto diamondSquare = std::make_shared<DiamondSquare>(1, 7.f, 1.f);
+    diamondSquare->setEdgeMode(EdgeMode::Seamless);
+
+    // The grid is only the first levels, so on a world small enough to generate at once it should match exactly
+    const unsigned int smallSize = 1025;
+    TiledDiamondSquare smallWorld(diamondSquare, smallSize, 64);
+    HeightField whole(smallSize);
+    diamondSquare->generate(whole);
+    HeightField smallCells(smallSize);
+    smallWorld.generate(smallCells);
+    int gridMismatches = 0;
+    for (unsigned int y = 0; y < smallSize; y += 64) {
+        for (unsigned int x = 0; x < smallSize; x += 64) {
+            gridMismatches += whole.at(static_cast<int>(x), static_cast<int>(y)) !=
+                              smallCells.at(static_cast<int>(x), static_cast<int>(y));
+        }
+    }
+
+    // Neighbouring cells generated on their own have to agree on their shared edges
+    int seamMismatches = 0;
+    HeightField cell(65), right(65), below(65);
+    for (int cellY = 0; cellY < 15; ++cellY) {
+        for (int cellX = 0; cellX < 15; ++cellX) {
+            smallWorld.generate(cell, cellX * 64, cellY * 64);
+            smallWorld.generate(right, (cellX + 1) * 64, cellY * 64);
+            smallWorld.generate(below, cellX * 64, (cellY + 1) * 64);
+            for (int i = 0; i <= 64; ++i) {
+                seamMismatches += cell.at(64, i) != right.at(0, i);
+                seamMismatches += cell.at(i, 64) != below.at(i, 0);
+                seamMismatches += cell.at(i, 64) != smallCells.at(cellX * 64 + i, cellY * 64 + 64);
+            }
+        }
+    }
+    printf("%d grid mismatches against a whole world, %d seam mismatches\n", gridMismatches, seamMismatches);
+
+    // Only written once, it's far too slow to repeat
+    auto start = std::chrono::steady_clock::now();
+    TiledDiamondSquare world(diamondSquare, size, cellSize);
+    double gridTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (!TiledHeightmap::create(path, size, cellSize, world.getMinHeight(), world.getMaxHeight(), world)) {
+        return 1;
+    }
+    double createTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    double samples = static_cast<double>(size) * size;
+    printf("%ux%u in cells of %u, grid in %.1f ms, %.1f MB file written in %.0f ms, %.1f M samples/s, "
+           "peak %.1f MB resident against %.1f MB for the whole world as floats\n", size, size, cellSize, gridTime,
+           static_cast<double>(file.tellg()) / (1024. * 1024.), createTime, samples / (createTime * 1000.),
+           peakMegabytes(), samples * sizeof(float) / (1024. * 1024.));
+
+    // Spot check the file against the generator, it should only be off by the 16 bit quantisation
+    TiledHeightmap heightmap(path);
+    if (!heightmap.isOpen()) {
+        return 1;
+    }
+    float maxError = 0.f;
+    Random random(2);
+    HeightField loaded(65), generated(65);
+    for (int i = 0; i < 64; ++i) {
+        int originX = static_cast<int>(random.next(0, i) % ((size - 1) / 64)) * 64;
+        int originY = static_cast<int>(random.next(1, i) % ((size - 1) / 64)) * 64;
+        heightmap.read(0, originX, originY, loaded);
+        world.generate(generated, originX, originY);
+        for (int y = 0; y < 65; ++y) {
+            for (int x = 0; x < 65; ++x) {
+                maxError = std::max(maxError, std::abs(loaded.at(x, y) - generated.at(x, y)));
+            }
+        }
+    }
+    printf("max error %.5f (quantisation step %.5f)\n", maxError,
+           (world.getMaxHeight() - world.getMinHeight()) / 65535.f);
+    return 0;
+}
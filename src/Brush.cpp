@@ -0,0 +1,87 @@
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "Brush.h"
+
+void DirtyRect::add(const DirtyRect &other) {
+    if (other.empty()) {
+        return;
+    }
+    if (empty()) {
+        *this = other;
+        return;
+    }
+    x0 = std::min(x0, other.x0);
+    y0 = std::min(y0, other.y0);
+    x1 = std::max(x1, other.x1);
+    y1 = std::max(y1, other.y1);
+}
+
+DirtyRect DirtyRect::expanded(int border, int size) const {
+    return {std::max(x0 - border, 0), std::max(y0 - border, 0), std::min(x1 + border, size),
+            std::min(y1 + border, size)};
+}
+
+DirtyRect applyBrush(HeightField &field, const Brush &brush, float x, float y) {
+    int size = static_cast<int>(field.getSize());
+    DirtyRect rect{
+            std::max(static_cast<int>(std::ceil(x - brush.radius)), 0),
+            std::max(static_cast<int>(std::ceil(y - brush.radius)), 0),
+            std::min(static_cast<int>(std::floor(x + brush.radius)) + 1, size),
+            std::min(static_cast<int>(std::floor(y + brush.radius)) + 1, size)
+    };
+    if (rect.empty() || brush.radius <= 0.f) {
+        return {0, 0, 0, 0};
+    }
+
+    // Smooth falloff, 1 at the centre and 0 at the radius
+    auto falloff = [&](int sampleX, int sampleY) {
+        float dx = static_cast<float>(sampleX) - x;
+        float dy = static_cast<float>(sampleY) - y;
+        float t = 1.f - (dx * dx + dy * dy) / (brush.radius * brush.radius);
+        return t > 0.f ? t * t : 0.f;
+    };
+
+    switch (brush.mode) {
+        case BrushMode::Raise:
+        case BrushMode::Lower: {
+            float amount = brush.mode == BrushMode::Raise ? brush.strength : -brush.strength;
+            field.forEachIn(rect.x0, rect.y0, rect.x1, rect.y1, [&](int sampleX, int sampleY, float &height) {
+                height += amount * falloff(sampleX, sampleY);
+            });
+            break;
+        }
+        case BrushMode::Flatten:
+            field.forEachIn(rect.x0, rect.y0, rect.x1, rect.y1, [&](int sampleX, int sampleY, float &height) {
+                height += (brush.target - height) * brush.strength * falloff(sampleX, sampleY);
+            });
+            break;
+        case BrushMode::Smooth: {
+            // Average from a copy, so samples that have already been smoothed don't feed into their neighbours
+            auto source = rect.expanded(1, size);
+            int width = source.x1 - source.x0;
+            std::vector<float> original(static_cast<size_t>(width) * (source.y1 - source.y0));
+            field.forEachIn(source.x0, source.y0, source.x1, source.y1, [&](int sampleX, int sampleY, float height) {
+                original[(sampleY - source.y0) * width + sampleX - source.x0] = height;
+            });
+            auto originalAt = [&](int sampleX, int sampleY) {
+                return original[(sampleY - source.y0) * width + sampleX - source.x0];
+            };
+
+            field.forEachIn(rect.x0, rect.y0, rect.x1, rect.y1, [&](int sampleX, int sampleY, float &height) {
+                float total = 0.f;
+                int count = 0;
+                for (int ny = std::max(sampleY - 1, source.y0); ny < std::min(sampleY + 2, source.y1); ++ny) {
+                    for (int nx = std::max(sampleX - 1, source.x0); nx < std::min(sampleX + 2, source.x1); ++nx) {
+                        total += originalAt(nx, ny);
+                        ++count;
+                    }
+                }
+                height += (total / static_cast<float>(count) - height) * brush.strength * falloff(sampleX, sampleY);
+            });
+            break;
+        }
+    }
+    return rect;
+}
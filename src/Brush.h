@@ -0,0 +1,54 @@
+
+#ifndef PROCGEN_BRUSH_H
+#define PROCGEN_BRUSH_H
+
+
+#include "HeightField.h"
+
+enum class BrushMode {
+    Raise,
+    Lower,
+    Flatten, // Pulls heights towards the brush's target height
+    Smooth // Blends heights towards the average of their neighbours
+};
+
+struct Brush {
+    BrushMode mode;
+    float radius; // In samples
+    float strength; // Height change at the centre for raise/lower, blend factor in [0, 1] for flatten/smooth
+    float target; // Flatten only
+};
+
+/**
+ * Region of a height field in samples, covering [x0, x1) x [y0, y1)
+ */
+struct DirtyRect {
+    int x0, y0;
+    int x1, y1;
+
+    bool empty() const {
+        return x0 >= x1 || y0 >= y1;
+    }
+
+    /**
+     * Grows the rect to also cover another one
+     */
+    void add(const DirtyRect &other);
+
+    /**
+     * Grows the rect by the given number of samples on each side, clamped to a field of the given size
+     */
+    DirtyRect expanded(int border, int size) const;
+};
+
+/**
+ * Applies a brush to the height field. Only samples within the brush radius are read or written, so the cost depends
+ * on the brush size rather than the field size
+ * @param x Brush centre in samples
+ * @param y Brush centre in samples
+ * @return The samples that may have changed, empty if the brush missed the field
+ */
+DirtyRect applyBrush(HeightField &field, const Brush &brush, float x, float y);
+
+
+#endif //PROCGEN_BRUSH_H
@@ -70,3 +70,7 @@ const glm::mat4 &Camera::getViewMatrix() const {
 const glm::mat4 &Camera::getProjMatrix() const {
     return projMatrix;
 }
+
+const glm::vec3 &Camera::getPosition() const {
+    return position;
+}
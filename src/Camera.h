@@ -33,6 +33,8 @@ public:
     const glm::mat4 &getViewMatrix() const;
 
     const glm::mat4 &getProjMatrix() const;
+
+    const glm::vec3 &getPosition() const;
 };
 
 
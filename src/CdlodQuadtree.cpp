@@ -0,0 +1,172 @@
+
+#include <algorithm>
+#include <iostream>
+#include "CdlodQuadtree.h"
+
+CdlodQuadtree::CdlodQuadtree(const HeightField &field, int leafSize)
+        : fieldSize(static_cast<int>(field.getSize())), leafSize(leafSize), levelCount(1) {
+    int span = fieldSize - 1;
+    if (leafSize <= 0 || span % leafSize != 0) {
+        std::cerr << "CDLOD leaf size " << leafSize << " doesn't divide the height field size " << span << std::endl;
+        this->leafSize = span;
+    }
+    while ((this->leafSize << (levelCount - 1)) < span) {
+        ++levelCount;
+    }
+
+    minHeights.resize(levelCount);
+    maxHeights.resize(levelCount);
+    for (int level = 0; level < levelCount; ++level) {
+        int nodes = span / (this->leafSize << level);
+        minHeights[level].resize(static_cast<size_t>(nodes) * nodes);
+        maxHeights[level].resize(static_cast<size_t>(nodes) * nodes);
+    }
+    updateBounds(field, 0, 0, fieldSize, fieldSize);
+    setLodRanges(static_cast<float>(this->leafSize) * 2.f);
+}
+
+void CdlodQuadtree::updateBounds(const HeightField &field, int x0, int z0, int x1, int z1) {
+    int span = fieldSize - 1;
+
+    // Leaves come straight from the heights. Neighbouring nodes share their edge samples
+    int leaves = span / leafSize;
+    int firstX = std::max((x0 - 1) / leafSize, 0), lastX = std::min((x1 - 1) / leafSize, leaves - 1);
+    int firstZ = std::max((z0 - 1) / leafSize, 0), lastZ = std::min((z1 - 1) / leafSize, leaves - 1);
+    for (int nodeZ = firstZ; nodeZ <= lastZ; ++nodeZ) {
+        for (int nodeX = firstX; nodeX <= lastX; ++nodeX) {
+            float low = field.at(nodeX * leafSize, nodeZ * leafSize);
+            float high = low;
+            field.forEachIn(nodeX * leafSize, nodeZ * leafSize, (nodeX + 1) * leafSize + 1, (nodeZ + 1) * leafSize + 1,
+                            [&](int, int, float height) {
+                                low = std::min(low, height);
+                                high = std::max(high, height);
+                            });
+            minHeights[0][nodeZ * leaves + nodeX] = low;
+            maxHeights[0][nodeZ * leaves + nodeX] = high;
+        }
+    }
+
+    // Each level above takes the bounds of its four children
+    for (int level = 1; level < levelCount; ++level) {
+        int nodes = span / (leafSize << level);
+        firstX /= 2;
+        lastX /= 2;
+        firstZ /= 2;
+        lastZ /= 2;
+        for (int nodeZ = firstZ; nodeZ <= lastZ; ++nodeZ) {
+            for (int nodeX = firstX; nodeX <= lastX; ++nodeX) {
+                int child = nodeZ * 2 * nodes * 2 + nodeX * 2;
+                int childRow = nodes * 2;
+                const auto &childMin = minHeights[level - 1];
+                const auto &childMax = maxHeights[level - 1];
+                minHeights[level][nodeZ * nodes + nodeX] = std::min(
+                        std::min(childMin[child], childMin[child + 1]),
+                        std::min(childMin[child + childRow], childMin[child + childRow + 1]));
+                maxHeights[level][nodeZ * nodes + nodeX] = std::max(
+                        std::max(childMax[child], childMax[child + 1]),
+                        std::max(childMax[child + childRow], childMax[child + childRow + 1]));
+            }
+        }
+    }
+}
+
+void CdlodQuadtree::setLodRanges(float finestRange, float morphStartRatio) {
+    lodRanges.resize(levelCount);
+    morphStarts.resize(levelCount);
+    float previous = 0.f;
+    for (int level = 0; level < levelCount; ++level) {
+        lodRanges[level] = finestRange * static_cast<float>(1 << level);
+        morphStarts[level] = previous + (lodRanges[level] - previous) * morphStartRatio;
+        previous = lodRanges[level];
+    }
+}
+
+bool CdlodQuadtree::inRange(int x, int z, int size, int level, const glm::vec3 &viewer, float range) const {
+    int nodes = (fieldSize - 1) / size;
+    int node = (z / size) * nodes + x / size;
+    float minY = minHeights[level][node];
+    float maxY = maxHeights[level][node];
+
+    // Distance from the viewer to the closest point of the node's bounding box
+    float dx = std::max(std::max(static_cast<float>(x) - viewer.x, viewer.x - static_cast<float>(x + size)), 0.f);
+    float dy = std::max(std::max(minY - viewer.y, viewer.y - maxY), 0.f);
+    float dz = std::max(std::max(static_cast<float>(z) - viewer.z, viewer.z - static_cast<float>(z + size)), 0.f);
+    return dx * dx + dy * dy + dz * dz <= range * range;
+}
+
+BoundingBox CdlodQuadtree::nodeBounds(int x, int z, int size, int level) const {
+    int nodes = (fieldSize - 1) / size;
+    int node = (z / size) * nodes + x / size;
+    return {glm::vec3(x, minHeights[level][node], z), glm::vec3(x + size, maxHeights[level][node], z + size)};
+}
+
+bool CdlodQuadtree::select(int x, int z, int level, const glm::vec3 &viewer, const Frustum *frustum,
+                           std::vector<CdlodSelection> &selection, CullStats &stats) const {
+    int size = leafSize << level;
+
+    // Too far away for this level, the parent covers the area instead. The root always covers the whole field
+    if (level < levelCount - 1 && !inRange(x, z, size, level, viewer, lodRanges[level])) {
+        return false;
+    }
+
+    // Out of view, counts as covered so the parent doesn't draw it either
+    if (frustum != nullptr) {
+        ++stats.tested;
+        if (!frustum->isVisible(nodeBounds(x, z, size, level))) {
+            ++stats.culled;
+            return true;
+        }
+    }
+
+    if (level == 0 || !inRange(x, z, size, level, viewer, lodRanges[level - 1])) {
+        selection.push_back({x, z, size, level, CDLOD_QUADRANT_ALL});
+        return true;
+    }
+
+    // Children that were out of range of the finer level get drawn as quadrants of this node
+    int half = size / 2;
+    unsigned int quadrants = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (!select(x + (i % 2) * half, z + (i / 2) * half, level - 1, viewer, frustum, selection, stats)) {
+            quadrants |= 1u << i;
+        }
+    }
+    if (quadrants != 0) {
+        selection.push_back({x, z, size, level, quadrants});
+    }
+    return true;
+}
+
+void CdlodQuadtree::select(const glm::vec3 &viewer, std::vector<CdlodSelection> &selection) const {
+    CullStats stats;
+    selection.clear();
+    select(0, 0, levelCount - 1, viewer, nullptr, selection, stats);
+}
+
+void CdlodQuadtree::select(const glm::vec3 &viewer, const Frustum &frustum, std::vector<CdlodSelection> &selection,
+                           CullStats &stats) const {
+    stats = CullStats();
+    selection.clear();
+    select(0, 0, levelCount - 1, viewer, &frustum, selection, stats);
+}
+
+int CdlodQuadtree::getLevelCount() const {
+    return levelCount;
+}
+
+int CdlodQuadtree::getLeafSize() const {
+    return leafSize;
+}
+
+float CdlodQuadtree::getLodRange(int level) const {
+    return lodRanges[level];
+}
+
+float CdlodQuadtree::getMorphStart(int level) const {
+    return morphStarts[level];
+}
+
+void CdlodQuadtree::getHeightRange(float &minY, float &maxY) const {
+    minY = minHeights[levelCount - 1][0];
+    maxY = maxHeights[levelCount - 1][0];
+}
@@ -0,0 +1,88 @@
+
+#ifndef PROCGEN_CDLODQUADTREE_H
+#define PROCGEN_CDLODQUADTREE_H
+
+
+#include <vec3.hpp>
+#include <vector>
+#include "Frustum.h"
+#include "HeightField.h"
+
+// Quadrants of a selected node, in the same order as the grid mesh's index ranges
+#define CDLOD_QUADRANT_ALL 0xf
+
+struct CdlodSelection {
+    int x, z; // Corner of the node in samples
+    int size; // Node size in samples
+    int level; // 0 is the finest
+    unsigned int quadrants; // Bit i set if quadrant i (top left, top right, bottom left, bottom right) is drawn
+};
+
+/**
+ * Quadtree over a height field for continuous distance-dependent level of detail (Strugar's CDLOD).
+ * Every node is drawn with the same grid mesh, so a node at level l has 2^l samples per grid quad. Each level is used
+ * up to a distance twice that of the level below, which keeps the number of selected nodes roughly constant no matter
+ * how large the field is.
+ * Only the height bounds of each node are stored, the nodes themselves are implied by their level and position
+ */
+class CdlodQuadtree {
+private:
+    int fieldSize;
+    int leafSize;
+    int levelCount;
+    // Per level, row major over the nodes in that level: min and max height of each node
+    std::vector<std::vector<float>> minHeights;
+    std::vector<std::vector<float>> maxHeights;
+    std::vector<float> lodRanges;
+    std::vector<float> morphStarts;
+
+    bool inRange(int x, int z, int size, int level, const glm::vec3 &viewer, float range) const;
+
+    BoundingBox nodeBounds(int x, int z, int size, int level) const;
+
+    bool select(int x, int z, int level, const glm::vec3 &viewer, const Frustum *frustum,
+                std::vector<CdlodSelection> &selection, CullStats &stats) const;
+
+public:
+    /**
+     * @param field The heights, must be 2^n+1 along each side
+     * @param leafSize Samples along the side of the smallest nodes, a power of two
+     */
+    CdlodQuadtree(const HeightField &field, int leafSize);
+
+    /**
+     * Recomputes the bounds of every node covering part of the given region
+     */
+    void updateBounds(const HeightField &field, int x0, int z0, int x1, int z1);
+
+    /**
+     * Sets how far each level is used. Level l is used up to finestRange * 2^l, and starts morphing into level l + 1
+     * at morphStartRatio of the way between its own range and the range of the level below
+     */
+    void setLodRanges(float finestRange, float morphStartRatio = .66f);
+
+    /**
+     * Picks the nodes to draw for a viewer
+     */
+    void select(const glm::vec3 &viewer, std::vector<CdlodSelection> &selection) const;
+
+    /**
+     * Picks the nodes to draw for a viewer, leaving out nodes outside the frustum. A culled node's children are never
+     * visited, so most of the tree behind the viewer costs a single test
+     */
+    void select(const glm::vec3 &viewer, const Frustum &frustum, std::vector<CdlodSelection> &selection,
+                CullStats &stats) const;
+
+    int getLevelCount() const;
+
+    int getLeafSize() const;
+
+    float getLodRange(int level) const;
+
+    float getMorphStart(int level) const;
+
+    void getHeightRange(float &minY, float &maxY) const;
+};
+
+
+#endif //PROCGEN_CDLODQUADTREE_H
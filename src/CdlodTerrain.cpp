@@ -0,0 +1,145 @@
+
+#include "CdlodTerrain.h"
+#include "IndexBuilder.h"
+#include "glHelper.h"
+
+#define TEX_SCALE .75f
+
+CdlodTerrain::CdlodTerrain(HeightField heightField, Shader *shader, Material &material)
+        : material(material), shader(shader), heightField(std::move(heightField)),
+          quadtree(this->heightField, CDLOD_GRID_SIZE) {
+    quadtree.getHeightRange(minY, maxY);
+    buildGrid();
+    uploadHeights();
+}
+
+CdlodTerrain::~CdlodTerrain() {
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ibo);
+    glDeleteTextures(1, &heightTexture);
+}
+
+void CdlodTerrain::buildGrid() {
+    int gridVertices = CDLOD_GRID_SIZE + 1;
+    std::vector<glm::vec2> positions;
+    positions.reserve(gridVertices * gridVertices);
+    for (int y = 0; y < gridVertices; ++y) {
+        for (int x = 0; x < gridVertices; ++x) {
+            positions.emplace_back(x, y);
+        }
+    }
+    auto indices = indexBuilder::buildGridQuadrants<unsigned short>(gridVertices);
+    quadrantIndexCount = static_cast<GLsizei>(indices.size() / 4);
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec2), positions.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), nullptr);
+    glEnableVertexAttribArray(0);
+
+    glGenBuffers(1, &ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+    GLERRCHECK();
+}
+
+void CdlodTerrain::uploadHeights() {
+    int size = static_cast<int>(heightField.getSize());
+
+    // The texture wants rows, tiled fields get copied out first
+    std::vector<float> rows;
+    const float *data = heightField.getData();
+    if (heightField.getLayout() != HeightLayout::RowMajor) {
+        rows.resize(static_cast<size_t>(size) * size);
+        heightField.forEach([&](int x, int y, float height) {
+            rows[static_cast<size_t>(size) * y + x] = height;
+        });
+        data = rows.data();
+    }
+
+    glGenTextures(1, &heightTexture);
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // Morphing vertices sit between samples, so they need filtering to stay on the surface
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, size, size, 0, GL_RED, GL_FLOAT, data);
+    GLERRCHECK();
+}
+
+void CdlodTerrain::render(const Camera &camera) {
+    Frustum frustum(camera.getProjMatrix() * camera.getViewMatrix());
+    quadtree.select(camera.getPosition(), frustum, selection, cullStats);
+
+    auto size = static_cast<float>(heightField.getSize());
+    shader->use();
+    shader->setMaterial(material);
+    shader->setUniform("minY", minY);
+    shader->setUniform("maxY", maxY);
+    shader->setUniform("heightMapSize", size);
+    shader->setUniform("cameraPos", camera.getPosition());
+    shader->setUniform("uvScale", size * TEX_SCALE / (size - 1.f));
+
+    // Terrain textures first, then the height map after them
+    for (int i = 0; i < material.textures.size(); ++i) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, material.textures[i]);
+        shader->setUniform(("textures[" + std::to_string(i) + "]").c_str(), i);
+    }
+    auto heightUnit = static_cast<int>(material.textures.size());
+    glActiveTexture(GL_TEXTURE0 + heightUnit);
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    shader->setUniform("heightMap", heightUnit);
+
+    glBindVertexArray(vao);
+    int lastLevel = -1;
+    for (const auto &node : selection) {
+        if (node.level != lastLevel) {
+            float morphStart = quadtree.getMorphStart(node.level);
+            float morphEnd = quadtree.getLodRange(node.level);
+            shader->setUniform("nodeScale", static_cast<float>(1 << node.level));
+            shader->setUniform("morphRange", glm::vec2(morphStart, 1.f / (morphEnd - morphStart)));
+            lastLevel = node.level;
+        }
+        shader->setUniform("nodeOffset", glm::vec2(node.x, node.z));
+
+        if (node.quadrants == CDLOD_QUADRANT_ALL) {
+            glDrawElements(GL_TRIANGLES, quadrantIndexCount * 4, GL_UNSIGNED_SHORT, nullptr);
+            continue;
+        }
+        for (int quadrant = 0; quadrant < 4; ++quadrant) {
+            if (node.quadrants & (1u << quadrant)) {
+                auto offset = static_cast<size_t>(quadrantIndexCount) * quadrant * sizeof(unsigned short);
+                glDrawElements(GL_TRIANGLES, quadrantIndexCount, GL_UNSIGNED_SHORT, (void *)offset);
+            }
+        }
+    }
+}
+
+void CdlodTerrain::setLodRange(float finestRange) {
+    quadtree.setLodRanges(finestRange);
+}
+
+size_t CdlodTerrain::getSelectedCount() const {
+    return selection.size();
+}
+
+size_t CdlodTerrain::getTriangleCount() const {
+    size_t quadrants = 0;
+    for (const auto &node : selection) {
+        for (int quadrant = 0; quadrant < 4; ++quadrant) {
+            quadrants += (node.quadrants >> quadrant) & 1u;
+        }
+    }
+    return quadrants * quadrantIndexCount / 3;
+}
+
+const CullStats &CdlodTerrain::getCullStats() const {
+    return cullStats;
+}
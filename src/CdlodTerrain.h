@@ -0,0 +1,78 @@
+
+#ifndef PROCGEN_CDLODTERRAIN_H
+#define PROCGEN_CDLODTERRAIN_H
+
+
+#include <vector>
+#include "Camera.h"
+#include "CdlodQuadtree.h"
+#include "HeightField.h"
+#include "Shader.h"
+#include "Terrain.h"
+
+// Quads along the side of the grid mesh drawn for every node
+#define CDLOD_GRID_SIZE 32
+
+/**
+ * Renders a large height field with continuous distance-dependent level of detail.
+ * The heights live in a float texture. Every selected quadtree node draws the same small grid mesh, which the vertex
+ * shader places, displaces and morphs towards the next level, so the triangle count depends on the LOD ranges rather
+ * than on the size of the field
+ */
+class CdlodTerrain {
+private:
+    GLuint vao;
+    GLuint vbo; // Grid vertex positions
+    GLuint ibo; // Grid indices, one quadrant after another
+    GLuint heightTexture;
+    GLsizei quadrantIndexCount;
+    Material material;
+    Shader *shader;
+
+    HeightField heightField;
+    CdlodQuadtree quadtree;
+    std::vector<CdlodSelection> selection;
+    CullStats cullStats;
+    float minY, maxY;
+
+    void buildGrid();
+
+    void uploadHeights();
+
+public:
+    /**
+     * @param heightField The heights, must be 2^n+1 along each side
+     * @param shader Shader built from cdlod_vert.glsl
+     */
+    CdlodTerrain(HeightField heightField, Shader *shader, Material &material);
+
+    ~CdlodTerrain();
+
+    /**
+     * Selects the nodes to draw for the camera, leaving out those outside its frustum, and draws them
+     */
+    void render(const Camera &camera);
+
+    /**
+     * Sets how far the finest level is used, each coarser level reaching twice as far as the one before
+     */
+    void setLodRange(float finestRange);
+
+    /**
+     * @return Number of nodes drawn last frame
+     */
+    size_t getSelectedCount() const;
+
+    /**
+     * @return Number of triangles drawn last frame
+     */
+    size_t getTriangleCount() const;
+
+    /**
+     * @return How many nodes were tested against the frustum and culled last frame
+     */
+    const CullStats &getCullStats() const;
+};
+
+
+#endif //PROCGEN_CDLODTERRAIN_H
@@ -0,0 +1,151 @@
+
+#include <algorithm>
+#include <cmath>
+#include "ChunkManager.h"
+#include "ThreadPool.h"
+
+ChunkManager::ChunkManager(unsigned short chunkSize, std::shared_ptr<const HeightGenerator> generator,
+                           int viewDistance, int uploadBudget, Shader *shader, Material &material)
+        : chunkSize(chunkSize), generator(std::move(generator)), viewDistance(viewDistance),
+          uploadBudget(uploadBudget), shader(shader), material(material), generated(new Generated) {}
+
+ChunkManager::~ChunkManager() {
+    for (auto &chunk : chunks) {
+        delete chunk.second;
+    }
+}
+
+ChunkCoord ChunkManager::toChunk(const glm::vec3 &position) const {
+    auto span = static_cast<float>(chunkSize - 1);
+    return {static_cast<int>(std::floor(position.x / span)), static_cast<int>(std::floor(position.z / span))};
+}
+
+void ChunkManager::update(const Camera &camera) {
+    auto centre = toChunk(camera.getPosition());
+    uploadChunks(centre);
+    freeChunks(centre);
+    requestChunks(centre);
+}
+
+void ChunkManager::requestChunks(const ChunkCoord &centre) {
+    // Find everything in range that isn't loaded or being generated
+    std::vector<ChunkCoord> missing;
+    for (int z = centre.z - viewDistance; z <= centre.z + viewDistance; ++z) {
+        for (int x = centre.x - viewDistance; x <= centre.x + viewDistance; ++x) {
+            ChunkCoord coord{x, z};
+            if (chunks.find(coord) == chunks.end() && pending.find(coord) == pending.end()) {
+                missing.push_back(coord);
+            }
+        }
+    }
+
+    // Nearest first, so the chunk the camera is on shows up before the ones on the horizon
+    auto distance = [&centre](const ChunkCoord &coord) {
+        return (coord.x - centre.x) * (coord.x - centre.x) + (coord.z - centre.z) * (coord.z - centre.z);
+    };
+    std::sort(missing.begin(), missing.end(), [&distance](const ChunkCoord &a, const ChunkCoord &b) {
+        return distance(a) < distance(b);
+    });
+
+    // Don't queue more than the pool can get through in a couple of frames, otherwise chunks left behind by a moving
+    // camera keep the pool busy
+    auto maxPending = static_cast<size_t>(ThreadPool::global().getThreadCount()) * 2;
+    for (const auto &coord : missing) {
+        if (pending.size() >= maxPending) {
+            break;
+        }
+        pending.insert(coord);
+
+        auto generated = this->generated;
+        auto generator = this->generator;
+        auto size = chunkSize;
+        ThreadPool::global().submit([generated, generator, coord, size]() {
+            HeightField heightField(size);
+            generator->generate(heightField, coord.x * (size - 1), coord.z * (size - 1));
+
+            std::lock_guard<std::mutex> lock(generated->mutex);
+            generated->chunks.emplace_back(coord, std::move(heightField));
+        });
+    }
+}
+
+void ChunkManager::uploadChunks(const ChunkCoord &centre) {
+    std::vector<std::pair<ChunkCoord, HeightField>> ready;
+    {
+        std::lock_guard<std::mutex> lock(generated->mutex);
+        ready.swap(generated->chunks);
+    }
+
+    int uploaded = 0;
+    std::vector<std::pair<ChunkCoord, HeightField>> deferred;
+    for (auto &chunk : ready) {
+        const auto &coord = chunk.first;
+
+        // Discard chunks the camera has moved away from while they were generating
+        if (std::abs(coord.x - centre.x) > viewDistance || std::abs(coord.z - centre.z) > viewDistance) {
+            pending.erase(coord);
+            continue;
+        }
+
+        // Uploads are what stall the frame, so anything over budget waits for the next one
+        if (uploaded >= uploadBudget) {
+            deferred.push_back(std::move(chunk));
+            continue;
+        }
+
+        auto terrain = new Terrain(std::move(chunk.second), shader, material);
+        auto span = static_cast<float>(chunkSize - 1);
+        terrain->setPosition(glm::vec3(coord.x * span, 0.f, coord.z * span));
+        // Every chunk textures against the same range, otherwise the sand/grass blend would jump at chunk edges
+        terrain->setHeightRange(-generator->getHeightScale(), generator->getHeightScale());
+        chunks[coord] = terrain;
+        pending.erase(coord);
+        ++uploaded;
+    }
+
+    if (!deferred.empty()) {
+        std::lock_guard<std::mutex> lock(generated->mutex);
+        for (auto &chunk : deferred) {
+            generated->chunks.push_back(std::move(chunk));
+        }
+    }
+}
+
+void ChunkManager::freeChunks(const ChunkCoord &centre) {
+    // One chunk of slack so moving back and forth over a chunk edge doesn't regenerate the same chunks
+    int freeDistance = viewDistance + 1;
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        const auto &coord = it->first;
+        if (std::abs(coord.x - centre.x) > freeDistance || std::abs(coord.z - centre.z) > freeDistance) {
+            delete it->second;
+            it = chunks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ChunkManager::render(const Frustum &frustum) {
+    drawList.clear();
+    drawBounds.clear();
+    for (auto &chunk : chunks) {
+        drawList.push_back(chunk.second);
+        drawBounds.add(chunk.second->getBounds());
+    }
+
+    cullStats.tested = drawList.size();
+    cullStats.culled = frustum.cull(drawBounds, visible);
+    for (size_t i = 0; i < drawList.size(); ++i) {
+        if (visible[i]) {
+            drawList[i]->render();
+        }
+    }
+}
+
+size_t ChunkManager::getChunkCount() const {
+    return chunks.size();
+}
+
+const CullStats &ChunkManager::getCullStats() const {
+    return cullStats;
+}
@@ -0,0 +1,101 @@
+
+#ifndef PROCGEN_CHUNKMANAGER_H
+#define PROCGEN_CHUNKMANAGER_H
+
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Camera.h"
+#include "Frustum.h"
+#include "HeightGenerator.h"
+#include "Terrain.h"
+
+struct ChunkCoord {
+    int x;
+    int z;
+
+    bool operator==(const ChunkCoord &other) const {
+        return x == other.x && z == other.z;
+    }
+};
+
+struct ChunkCoordHash {
+    size_t operator()(const ChunkCoord &coord) const {
+        return std::hash<long long>()((static_cast<long long>(coord.x) << 32) ^ static_cast<unsigned int>(coord.z));
+    }
+};
+
+/**
+ * Keeps the terrain chunks around the camera loaded. Chunks are generated at their world position, so neighbouring
+ * chunks agree along their shared edges as long as the generator does (e.g. diamond-square in seamless mode).
+ * Heights are generated on the thread pool; the OpenGL upload happens in update(), limited to a few chunks a frame.
+ */
+class ChunkManager {
+private:
+    // Shared with the generation tasks, so it stays alive if the manager is destroyed with tasks still running
+    struct Generated {
+        std::mutex mutex;
+        std::vector<std::pair<ChunkCoord, HeightField>> chunks;
+    };
+
+    unsigned short chunkSize;
+    std::shared_ptr<const HeightGenerator> generator;
+    int viewDistance;
+    int uploadBudget;
+    Shader *shader;
+    Material material;
+
+    std::unordered_map<ChunkCoord, Terrain *, ChunkCoordHash> chunks;
+    std::unordered_set<ChunkCoord, ChunkCoordHash> pending;
+    std::shared_ptr<Generated> generated;
+
+    // Reused every frame for culling
+    std::vector<Terrain *> drawList;
+    BoundingBoxes drawBounds;
+    std::vector<unsigned char> visible;
+    CullStats cullStats;
+
+    ChunkCoord toChunk(const glm::vec3 &position) const;
+
+    void requestChunks(const ChunkCoord &centre);
+
+    void uploadChunks(const ChunkCoord &centre);
+
+    void freeChunks(const ChunkCoord &centre);
+
+public:
+    /**
+     * @param chunkSize Samples along one side of a chunk, 2^n+1 for diamond-square
+     * @param generator Shared with the generation tasks, which run on the thread pool
+     * @param viewDistance How many chunks to keep loaded in each direction around the camera
+     * @param uploadBudget Maximum number of chunks uploaded to OpenGL per frame
+     */
+    ChunkManager(unsigned short chunkSize, std::shared_ptr<const HeightGenerator> generator, int viewDistance,
+                 int uploadBudget, Shader *shader, Material &material);
+
+    ~ChunkManager();
+
+    /**
+     * Queues generation of chunks that have come into range, uploads finished ones and frees those out of range.
+     * Should be called once a frame
+     */
+    void update(const Camera &camera);
+
+    /**
+     * Draws the loaded chunks that are inside the frustum
+     */
+    void render(const Frustum &frustum);
+
+    size_t getChunkCount() const;
+
+    /**
+     * @return How many chunks were tested and culled by the last render
+     */
+    const CullStats &getCullStats() const;
+};
+
+
+#endif //PROCGEN_CHUNKMANAGER_H
@@ -0,0 +1,221 @@
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "DiamondSquare.h"
+#include "ThreadPool.h"
+
+DiamondSquare::DiamondSquare(unsigned int seed, float maxRand, float h)
+        : random(seed), maxRand(maxRand), h(h), rowKernels(&kernels::best()) {}
+
+void DiamondSquare::setKernels(const kernels::RowKernels &rowKernels) {
+    DiamondSquare::rowKernels = &rowKernels;
+}
+
+void DiamondSquare::setEdgeMode(EdgeMode edgeMode) {
+    DiamondSquare::edgeMode = edgeMode;
+}
+
+void DiamondSquare::generate(HeightField &field, int originX, int originY) const {
+    int size = field.getSize();
+    int last = size - 1;
+    std::fill(field.getData(), field.getData() + field.getDataSize(), 0.f);
+
+    auto corner = [&](int x, int y) {
+        field.at(x, y) = random.uniform(last, Random::counter(originX + x, originY + y), -maxRand, maxRand);
+    };
+    corner(0, 0);
+    corner(0, last);
+    corner(last, last);
+    corner(last, 0);
+
+    diamondSquare(field, last, maxRand, originX, originY, 1, edgeMode);
+}
+
+float DiamondSquare::generateGrid(HeightField &grid, int spacing) const {
+    int last = grid.getSize() - 1;
+    // Keyed by world position and world step size, the same as the samples of a field the size of the world
+    auto corner = [&](int x, int y) {
+        grid.at(x, y) = random.uniform(last * spacing, Random::counter(x * spacing, y * spacing), -maxRand, maxRand);
+    };
+    corner(0, 0);
+    corner(0, last);
+    corner(last, last);
+    corner(last, 0);
+
+    return diamondSquare(grid, last, maxRand, 0, 0, spacing, edgeMode);
+}
+
+float DiamondSquare::refineGrid(HeightField &grid, const HeightField &coarse, int spacing, float randMax) const {
+    coarse.forEach([&](int x, int y, float height) {
+        grid.at(x * 2, y * 2) = height;
+    });
+    return diamondSquare(grid, 2, randMax, 0, 0, spacing, edgeMode);
+}
+
+void DiamondSquare::refine(HeightField &field, float randMax, int originX, int originY) const {
+    diamondSquare(field, field.getSize() - 1, randMax, originX, originY, 1, EdgeMode::Seamless);
+}
+
+float DiamondSquare::getHeightScale() const {
+    return maxRand;
+}
+
+float DiamondSquare::getSmoothness() const {
+    return h;
+}
+
+void DiamondSquare::hash(Hasher &hasher) const {
+    hasher.add("DiamondSquare").add(random.getSeed()).add(maxRand).add(h).add(edgeMode);
+}
+
+float DiamondSquare::diamondStep(const HeightField &field, int x, int y, int stepSize) const {
+    float averagesize = 0.f;
+    int xMin = x - stepSize;
+    int xMax = x + stepSize;
+    int yMin = y - stepSize;
+    int yMax = y + stepSize;
+    averagesize += field.at(xMin, yMin); // Top left
+    averagesize += field.at(xMin, yMax); // Bottom left
+    averagesize += field.at(xMax, yMin); // Top right
+    averagesize += field.at(xMax, yMax); // Bottom right
+    return averagesize / 4.f;
+}
+
+/**
+ * Calculates the average size for the provided vertex based on a diamond pattern around it.
+ * Only used for the points on the edges and for tiled height fields, the rest go through the row kernels.
+ * In seamless mode points on the edge only average the two neighbours along the edge
+ * @param field
+ * @param x
+ * @param y
+ * @param stepSize
+ * @param edgeMode
+ */
+float DiamondSquare::squareStep(const HeightField &field, int x, int y, int stepSize, EdgeMode edgeMode) const {
+    int size = field.getSize();
+    if (edgeMode == EdgeMode::Seamless) {
+        if (y == 0 || y == size - 1) {
+            return (field.at(x - stepSize, y) + field.at(x + stepSize, y)) / 2.f;
+        }
+        if (x == 0 || x == size - 1) {
+            return (field.at(x, y - stepSize) + field.at(x, y + stepSize)) / 2.f;
+        }
+    }
+
+    float averagesize = 0.f;
+    int xMin = x - stepSize;
+    int xMax = x + stepSize;
+    int yMin = y - stepSize;
+    int yMax = y + stepSize;
+    if (xMin < 0) {
+        xMin = size - abs(xMin);
+    }
+    averagesize += field.at(xMin, y); // Left
+    if (xMax >= size) {
+        xMax = xMax - size;
+    }
+    averagesize += field.at(xMax, y); // Right
+    if (yMin < 0) {
+        yMin = size - abs(yMin);
+    }
+    averagesize += field.at(x, yMin); // Top
+    if (yMax >= size) {
+        yMax = yMax - size;
+    }
+    averagesize += field.at(x, yMax); // Bottom
+    return averagesize / 4.f;
+}
+
+/**
+ * Applies the Diamond-Square algorithm to the height field one level at a time.
+ * Each diamond and square pass is split across the thread pool by row, with parallelFor acting as the barrier between
+ * passes. Random offsets come from the counter based generator keyed by (seed, step size, x, y) so the result does not
+ * depend on which thread handles which row.
+ * Row major height fields go through the row kernels, tiled ones fall back to sampling a point at a time.
+ * @param field The height field
+ * @param stepSize The initial step size
+ * @param randMax Maximum random offset
+ * @param originX World position of the field, in samples
+ * @param originY World position of the field, in samples
+ * @param spacing World samples between the field's samples, more than 1 for a coarse grid
+ * @param edgeMode How square steps on the edges of the field find their neighbours
+ * @return Maximum random offset for the level after the last one run
+ */
+float DiamondSquare::diamondSquare(HeightField &field, int stepSize, float randMax, int originX, int originY,
+                                   int spacing, EdgeMode edgeMode) const {
+    auto &pool = ThreadPool::global();
+    int size = field.getSize();
+    bool rowMajor = field.getLayout() == HeightLayout::RowMajor;
+
+    for (; stepSize > 1; stepSize /= 2, randMax *= powf(2, -h)) {
+        int halfStepSize = stepSize / 2;
+        int steps = (size - 1) / stepSize;
+
+        // Diamond step
+        pool.parallelFor(0, steps, [&](int row) {
+            int y = halfStepSize + row * stepSize;
+            std::vector<float> offsets(steps);
+            random.uniformRow(stepSize * spacing, originX + halfStepSize * spacing, stepSize * spacing,
+                              originY + y * spacing, steps, -randMax, randMax, offsets.data());
+            if (rowMajor) {
+                rowKernels->diamondRow(field.row(y - halfStepSize), field.row(y + halfStepSize),
+                                       field.row(y) + halfStepSize, offsets.data(), steps, stepSize);
+                return;
+            }
+            for (int column = 0; column < steps; ++column) {
+                int x = halfStepSize + column * stepSize;
+                field.at(x, y) = diamondStep(field, x, y, halfStepSize) + offsets[column];
+            }
+        });
+
+        // Square step. The last row and column wrap around onto the first ones, which a serial pass would have
+        // already updated by the time it reached them, so they have to wait for a second pass
+        int last = 2 * steps;
+        auto squareRow = [&](int row, int firstColumn, int lastColumn) {
+            int y = row * halfStepSize;
+            int count = (lastColumn - firstColumn + 1) / 2;
+            std::vector<float> offsets(count);
+            random.uniformRow(stepSize * spacing, originX + firstColumn * halfStepSize * spacing, stepSize * spacing,
+                              originY + y * spacing, count, -randMax, randMax, offsets.data());
+
+            // Rows wrap as a whole, so only the first and last point in a row can need a wrapped neighbour
+            int first = 0;
+            int end = count;
+            int x = firstColumn * halfStepSize;
+            if (x - halfStepSize < 0) {
+                field.at(x, y) = squareStep(field, x, y, halfStepSize, edgeMode) + offsets[0];
+                first = 1;
+            }
+            int lastX = x + (count - 1) * stepSize;
+            if (end > first && lastX + halfStepSize >= size) {
+                field.at(lastX, y) = squareStep(field, lastX, y, halfStepSize, edgeMode) + offsets[count - 1];
+                end = count - 1;
+            }
+            bool seamlessEdge = edgeMode == EdgeMode::Seamless && (y == 0 || y == size - 1);
+            if (end > first && (!rowMajor || seamlessEdge)) {
+                for (int i = first; i < end; ++i) {
+                    int pointX = x + i * stepSize;
+                    field.at(pointX, y) = squareStep(field, pointX, y, halfStepSize, edgeMode) + offsets[i];
+                }
+            } else if (end > first) {
+                int yAbove = y - halfStepSize < 0 ? size - halfStepSize : y - halfStepSize;
+                int yBelow = y + halfStepSize >= size ? y + halfStepSize - size : y + halfStepSize;
+                x += first * stepSize;
+                rowKernels->squareRow(field.row(yAbove) + x, field.row(yBelow) + x, field.row(y) + x,
+                                      offsets.data() + first, end - first, stepSize);
+            }
+        };
+        pool.parallelFor(0, last, [&](int row) {
+            squareRow(row, (row + 1) % 2, last);
+        });
+        pool.parallelFor(0, last + 1, [&](int row) {
+            if (row == last) {
+                squareRow(row, 1, last);
+            } else if (row % 2 == 1) {
+                squareRow(row, last, last + 2);
+            }
+        });
+    }
+    return randMax;
+}
@@ -0,0 +1,92 @@
+
+#ifndef PROCGEN_DIAMONDSQUARE_H
+#define PROCGEN_DIAMONDSQUARE_H
+
+
+#include "DiamondSquareKernels.h"
+#include "HeightField.h"
+#include "HeightGenerator.h"
+#include "Random.h"
+
+enum class EdgeMode {
+    Wrap, // Square steps on the edges wrap around to the opposite edge
+    Seamless // Edges only use samples along the edge, so fields that share an edge generate the same values for it
+};
+
+/**
+ * Diamond-Square height generator. The height field size must be 2^n+1
+ */
+class DiamondSquare : public HeightGenerator {
+private:
+    Random random;
+    float maxRand, h;
+    const kernels::RowKernels *rowKernels;
+    EdgeMode edgeMode = EdgeMode::Wrap;
+
+    float diamondStep(const HeightField &field, int x, int y, int stepSize) const;
+
+    float squareStep(const HeightField &field, int x, int y, int stepSize, EdgeMode edgeMode) const;
+
+    /**
+     * @return Maximum random offset for the level after the last one run
+     */
+    float diamondSquare(HeightField &field, int stepSize, float randMax, int originX, int originY, int spacing,
+                        EdgeMode edgeMode) const;
+
+public:
+    /**
+     * @param seed World seed
+     * @param maxRand Maximum random offset at the first level
+     * @param h The smoothness. The random offset is scaled by 2^-h each level
+     */
+    DiamondSquare(unsigned int seed, float maxRand, float h);
+
+    /**
+     * Fills the height field, replacing anything already in it.
+     * Random offsets are keyed by world position, so two seamless fields that share an edge get the same offsets along
+     * it
+     */
+    void generate(HeightField &field, int originX = 0, int originY = 0) const override;
+
+    /**
+     * Fills a grid with every spacing-th sample of a world (grid size - 1) * spacing across, i.e. its first levels.
+     * In seamless mode the heights are the same ones generate would give those samples of the whole world
+     * @return Maximum random offset of the first level finer than the grid, to pass to refine
+     */
+    float generateGrid(HeightField &grid, int spacing) const;
+
+    /**
+     * Fills a grid from one with half the samples along each side by running just the next level. In seamless mode it's
+     * the same as calling generateGrid at half the spacing, without running the earlier levels again
+     * @param coarse A grid filled by generateGrid or refineGrid at twice the spacing
+     * @param randMax What filling the coarse grid returned
+     * @return Maximum random offset of the level after this one
+     */
+    float refineGrid(HeightField &grid, const HeightField &coarse, int spacing, float randMax) const;
+
+    /**
+     * Runs the remaining levels over a field whose corners are already set, e.g. to the corners of one cell of a grid.
+     * The edges are always seamless, so cells refined separately meet their neighbours exactly
+     * @param randMax Maximum random offset at the field's first level
+     */
+    void refine(HeightField &field, float randMax, int originX, int originY) const;
+
+    float getHeightScale() const override;
+
+    /**
+     * @return h, the power of two the random offset shrinks by each level
+     */
+    float getSmoothness() const;
+
+    void hash(Hasher &hasher) const override;
+
+    /**
+     * Overrides the row kernels picked for this CPU, e.g. to compare against the scalar reference
+     */
+    void setKernels(const kernels::RowKernels &rowKernels);
+
+    void setEdgeMode(EdgeMode edgeMode);
+};
+
+
+#endif //PROCGEN_DIAMONDSQUARE_H
@@ -0,0 +1,194 @@
+
+#include "DiamondSquareKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(__GNUC__) || defined(__clang__)
+#define PROCGEN_KERNELS_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define PROCGEN_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace kernels {
+    namespace {
+        void diamondRowScalar(const float *above, const float *below, float *out, const float *offsets, int count,
+                              int step) {
+            for (int i = 0; i < count; ++i) {
+                int x = i * step;
+                float averagesize = 0.f;
+                averagesize += above[x]; // Top left
+                averagesize += below[x]; // Bottom left
+                averagesize += above[x + step]; // Top right
+                averagesize += below[x + step]; // Bottom right
+                out[x] = averagesize / 4.f + offsets[i];
+            }
+        }
+
+        void squareRowScalar(const float *above, const float *below, float *out, const float *offsets, int count,
+                             int step) {
+            int half = step / 2;
+            for (int i = 0; i < count; ++i) {
+                int x = i * step;
+                float averagesize = 0.f;
+                averagesize += out[x - half]; // Left
+                averagesize += out[x + half]; // Right
+                averagesize += above[x]; // Top
+                averagesize += below[x]; // Bottom
+                out[x] = averagesize / 4.f + offsets[i];
+            }
+        }
+
+#ifdef PROCGEN_KERNELS_AVX2
+        // Only AVX2 is enabled, not FMA, so the compiler can't fuse the multiply and add and change the rounding.
+        // Coarser levels are left to the scalar loop, gathers end up slower than plain loads there
+
+        // Spreads four offsets out to the even lanes
+        __attribute__((target("avx2")))
+        inline __m256 loadOffsets(const float *offsets) {
+            return _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_loadu_ps(offsets)),
+                                            _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3));
+        }
+
+        /*
+         * The finest level (step 2) is most of the work. Its samples are every other float, so whole rows are worked on
+         * with contiguous loads and only the even lanes are kept, which avoids gathers and shuffles entirely.
+         * Both loops stop a block early so the last load can't read past the end of the row
+         */
+
+        __attribute__((target("avx2")))
+        int diamondRowAvx2Step2(const float *above, const float *below, float *out, const float *offsets, int count) {
+            const __m256 quarter = _mm256_set1_ps(.25f);
+            int i = 0;
+            for (; i + 5 <= count; i += 4) {
+                int x = i * 2;
+                __m256 sum = _mm256_setzero_ps();
+                sum = _mm256_add_ps(sum, _mm256_loadu_ps(above + x)); // Top left
+                sum = _mm256_add_ps(sum, _mm256_loadu_ps(below + x)); // Bottom left
+                sum = _mm256_add_ps(sum, _mm256_loadu_ps(above + x + 2)); // Top right
+                sum = _mm256_add_ps(sum, _mm256_loadu_ps(below + x + 2)); // Bottom right
+                __m256 values = _mm256_add_ps(_mm256_mul_ps(sum, quarter), loadOffsets(offsets + i));
+
+                // Nothing else reads or writes this row during the diamond pass so the odd lanes can be written back
+                _mm256_storeu_ps(out + x, _mm256_blend_ps(_mm256_loadu_ps(out + x), values, 0x55));
+            }
+            return i;
+        }
+
+        __attribute__((target("avx2")))
+        int squareRowAvx2Step2(const float *above, const float *below, float *out, const float *offsets, int count) {
+            const __m256 quarter = _mm256_set1_ps(.25f);
+            alignas(32) float values[8];
+            int i = 0;
+            for (; i + 5 <= count; i += 4) {
+                int x = i * 2;
+                __m256 sum = _mm256_setzero_ps();
+                sum = _mm256_add_ps(sum, _mm256_loadu_ps(out + x - 1)); // Left
+                sum = _mm256_add_ps(sum, _mm256_loadu_ps(out + x + 1)); // Right
+                sum = _mm256_add_ps(sum, _mm256_loadu_ps(above + x)); // Top
+                sum = _mm256_add_ps(sum, _mm256_loadu_ps(below + x)); // Bottom
+                _mm256_store_ps(values, _mm256_add_ps(_mm256_mul_ps(sum, quarter), loadOffsets(offsets + i)));
+
+                // Other threads read the odd lanes during the square pass, so they must not be written to at all.
+                // Separate stores rather than a masked one so the next block's loads don't stall on store forwarding
+                out[x] = values[0];
+                out[x + 2] = values[2];
+                out[x + 4] = values[4];
+                out[x + 6] = values[6];
+            }
+            return i;
+        }
+
+        __attribute__((target("avx2")))
+        void diamondRowAvx2(const float *above, const float *below, float *out, const float *offsets, int count,
+                            int step) {
+            int i = step == 2 ? diamondRowAvx2Step2(above, below, out, offsets, count) : 0;
+            diamondRowScalar(above + i * step, below + i * step, out + i * step, offsets + i, count - i, step);
+        }
+
+        __attribute__((target("avx2")))
+        void squareRowAvx2(const float *above, const float *below, float *out, const float *offsets, int count,
+                           int step) {
+            int i = step == 2 ? squareRowAvx2Step2(above, below, out, offsets, count) : 0;
+            squareRowScalar(above + i * step, below + i * step, out + i * step, offsets + i, count - i, step);
+        }
+#endif
+
+#ifdef PROCGEN_KERNELS_NEON
+        /*
+         * Like the AVX2 kernels only the finest level is vectorised, where vld2q splits even and odd samples in one
+         * load. Divides rather than multiplying by a quarter so the compiler can't contract it into a fused multiply add
+         */
+
+        inline void storeEven(float *data, float32x4_t values) {
+            vst1q_lane_f32(data, values, 0);
+            vst1q_lane_f32(data + 2, values, 1);
+            vst1q_lane_f32(data + 4, values, 2);
+            vst1q_lane_f32(data + 6, values, 3);
+        }
+
+        void diamondRowNeon(const float *above, const float *below, float *out, const float *offsets, int count,
+                            int step) {
+            const float32x4_t four = vdupq_n_f32(4.f);
+            int i = 0;
+            if (step == 2) {
+                for (; i + 5 <= count; i += 4) {
+                    int x = i * 2;
+                    float32x4_t sum = vdupq_n_f32(0.f);
+                    sum = vaddq_f32(sum, vld2q_f32(above + x).val[0]); // Top left
+                    sum = vaddq_f32(sum, vld2q_f32(below + x).val[0]); // Bottom left
+                    sum = vaddq_f32(sum, vld2q_f32(above + x + 2).val[0]); // Top right
+                    sum = vaddq_f32(sum, vld2q_f32(below + x + 2).val[0]); // Bottom right
+                    storeEven(out + x, vaddq_f32(vdivq_f32(sum, four), vld1q_f32(offsets + i)));
+                }
+            }
+            diamondRowScalar(above + i * step, below + i * step, out + i * step, offsets + i, count - i, step);
+        }
+
+        void squareRowNeon(const float *above, const float *below, float *out, const float *offsets, int count,
+                           int step) {
+            const float32x4_t four = vdupq_n_f32(4.f);
+            int i = 0;
+            if (step == 2) {
+                for (; i + 5 <= count; i += 4) {
+                    int x = i * 2;
+                    float32x4_t sum = vdupq_n_f32(0.f);
+                    sum = vaddq_f32(sum, vld2q_f32(out + x - 1).val[0]); // Left
+                    sum = vaddq_f32(sum, vld2q_f32(out + x + 1).val[0]); // Right
+                    sum = vaddq_f32(sum, vld2q_f32(above + x).val[0]); // Top
+                    sum = vaddq_f32(sum, vld2q_f32(below + x).val[0]); // Bottom
+                    storeEven(out + x, vaddq_f32(vdivq_f32(sum, four), vld1q_f32(offsets + i)));
+                }
+            }
+            squareRowScalar(above + i * step, below + i * step, out + i * step, offsets + i, count - i, step);
+        }
+#endif
+
+        const RowKernels scalarKernels{"scalar", diamondRowScalar, squareRowScalar};
+
+        const RowKernels &detect() {
+#ifdef PROCGEN_KERNELS_AVX2
+            static const RowKernels avx2Kernels{"avx2", diamondRowAvx2, squareRowAvx2};
+            if (__builtin_cpu_supports("avx2")) {
+                return avx2Kernels;
+            }
+#endif
+#ifdef PROCGEN_KERNELS_NEON
+            // NEON is always available on AArch64
+            static const RowKernels neonKernels{"neon", diamondRowNeon, squareRowNeon};
+            return neonKernels;
+#endif
+            return scalarKernels;
+        }
+    }
+
+    const RowKernels &scalar() {
+        return scalarKernels;
+    }
+
+    const RowKernels &best() {
+        static const RowKernels &kernels = detect();
+        return kernels;
+    }
+}
@@ -0,0 +1,50 @@
+
+#ifndef PROCGEN_DIAMONDSQUAREKERNELS_H
+#define PROCGEN_DIAMONDSQUAREKERNELS_H
+
+
+/**
+ * Row kernels for the diamond and square steps. Every kernel adds up its four samples in the same order as the scalar
+ * reference (left/top left first) so all implementations give bit identical results.
+ */
+namespace kernels {
+    /**
+     * Diamond step for one row: out[i * step] = average(above[i * step], below[i * step],
+     *                                                    above[(i + 1) * step], below[(i + 1) * step]) + offsets[i]
+     * @param above Row half a step above, starting at the first corner
+     * @param below Row half a step below, starting at the first corner
+     * @param out Row being written, starting at the first diamond centre
+     */
+    typedef void (*DiamondRowFn)(const float *above, const float *below, float *out, const float *offsets, int count,
+                                 int step);
+
+    /**
+     * Square step for the non-wrapping part of one row: out[i * step] = average(out[i * step - half],
+     *                                      out[i * step + half], above[i * step], below[i * step]) + offsets[i]
+     * The row is both read and written, but the samples read are never ones being written
+     * @param above Row half a step above, already offset to the first point
+     * @param below Row half a step below, already offset to the first point
+     * @param out Row being written, starting at the first point
+     */
+    typedef void (*SquareRowFn)(const float *above, const float *below, float *out, const float *offsets, int count,
+                                int step);
+
+    struct RowKernels {
+        const char *name;
+        DiamondRowFn diamondRow;
+        SquareRowFn squareRow;
+    };
+
+    /**
+     * Plain C++ reference kernels
+     */
+    const RowKernels &scalar();
+
+    /**
+     * The fastest kernels the current CPU supports, picked the first time this is called
+     */
+    const RowKernels &best();
+}
+
+
+#endif //PROCGEN_DIAMONDSQUAREKERNELS_H
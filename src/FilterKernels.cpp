@@ -0,0 +1,185 @@
+
+#include <algorithm>
+#include <cmath>
+#include "FilterKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(__GNUC__) || defined(__clang__)
+#define PROCGEN_FILTER_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+namespace filter {
+    namespace {
+        /**
+         * How far a height difference goes past the talus, keeping its sign. 0 when it's within the talus
+         */
+        inline float excess(float difference, float talus) {
+            return difference - std::min(std::max(difference, -talus), talus);
+        }
+
+        void thermalRowScalar(const float *above, const float *row, const float *below, int count, float talus,
+                              float rate, float *out) {
+            for (int i = 0; i < count; ++i) {
+                float centre = row[i];
+                float moved = excess(centre - row[i - 1], talus) + excess(centre - row[i + 1], talus);
+                moved += excess(centre - above[i], talus);
+                moved += excess(centre - below[i], talus);
+                out[i] = centre - rate * moved;
+            }
+        }
+
+        void blurRowScalar(const float *row, const float *weights, int radius, int count, float *out) {
+            for (int i = 0; i < count; ++i) {
+                float sum = weights[0] * row[i - radius];
+                for (int k = 1; k <= radius * 2; ++k) {
+                    sum += weights[k] * row[i + k - radius];
+                }
+                out[i] = sum;
+            }
+        }
+
+        void blurColumnScalar(const float *const *rows, const float *weights, int radius, int count, float *out) {
+            for (int i = 0; i < count; ++i) {
+                float sum = weights[0] * rows[0][i];
+                for (int k = 1; k <= radius * 2; ++k) {
+                    sum += weights[k] * rows[k][i];
+                }
+                out[i] = sum;
+            }
+        }
+
+        void terraceRowScalar(float *row, int count, float stepHeight, float ramp) {
+            float inverseStep = 1.f / stepHeight;
+            float inverseRamp = 1.f / std::max(ramp, 1e-6f);
+            for (int i = 0; i < count; ++i) {
+                float steps = row[i] * inverseStep;
+                float step = std::floor(steps);
+                float slope = std::min(std::max((steps - step - (1.f - ramp)) * inverseRamp, 0.f), 1.f);
+                row[i] = (step + slope) * stepHeight;
+            }
+        }
+
+        void clampRowScalar(float *row, int count, float min, float max) {
+            for (int i = 0; i < count; ++i) {
+                row[i] = std::min(std::max(row[i], min), max);
+            }
+        }
+
+#ifdef PROCGEN_FILTER_AVX2
+        __attribute__((target("avx2")))
+        inline __m256 excessAvx2(__m256 difference, __m256 talus, __m256 negativeTalus) {
+            return _mm256_sub_ps(difference, _mm256_min_ps(_mm256_max_ps(difference, negativeTalus), talus));
+        }
+
+        __attribute__((target("avx2")))
+        void thermalRowAvx2(const float *above, const float *row, const float *below, int count, float talus,
+                            float rate, float *out) {
+            const __m256 talusVector = _mm256_set1_ps(talus);
+            const __m256 negativeTalus = _mm256_set1_ps(-talus);
+            const __m256 rateVector = _mm256_set1_ps(rate);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 centre = _mm256_loadu_ps(row + i);
+                __m256 moved = _mm256_add_ps(
+                        excessAvx2(_mm256_sub_ps(centre, _mm256_loadu_ps(row + i - 1)), talusVector, negativeTalus),
+                        excessAvx2(_mm256_sub_ps(centre, _mm256_loadu_ps(row + i + 1)), talusVector, negativeTalus));
+                moved = _mm256_add_ps(moved, excessAvx2(_mm256_sub_ps(centre, _mm256_loadu_ps(above + i)),
+                                                        talusVector, negativeTalus));
+                moved = _mm256_add_ps(moved, excessAvx2(_mm256_sub_ps(centre, _mm256_loadu_ps(below + i)),
+                                                        talusVector, negativeTalus));
+                _mm256_storeu_ps(out + i, _mm256_sub_ps(centre, _mm256_mul_ps(rateVector, moved)));
+            }
+            thermalRowScalar(above + i, row + i, below + i, count - i, talus, rate, out + i);
+        }
+
+        __attribute__((target("avx2")))
+        void blurRowAvx2(const float *row, const float *weights, int radius, int count, float *out) {
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 sum = _mm256_mul_ps(_mm256_set1_ps(weights[0]), _mm256_loadu_ps(row + i - radius));
+                for (int k = 1; k <= radius * 2; ++k) {
+                    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]),
+                                                           _mm256_loadu_ps(row + i + k - radius)));
+                }
+                _mm256_storeu_ps(out + i, sum);
+            }
+            blurRowScalar(row + i, weights, radius, count - i, out + i);
+        }
+
+        __attribute__((target("avx2")))
+        void blurColumnAvx2(const float *const *rows, const float *weights, int radius, int count, float *out) {
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 sum = _mm256_mul_ps(_mm256_set1_ps(weights[0]), _mm256_loadu_ps(rows[0] + i));
+                for (int k = 1; k <= radius * 2; ++k) {
+                    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i)));
+                }
+                _mm256_storeu_ps(out + i, sum);
+            }
+            for (; i < count; ++i) {
+                float sum = weights[0] * rows[0][i];
+                for (int k = 1; k <= radius * 2; ++k) {
+                    sum += weights[k] * rows[k][i];
+                }
+                out[i] = sum;
+            }
+        }
+
+        __attribute__((target("avx2")))
+        void terraceRowAvx2(float *row, int count, float stepHeight, float ramp) {
+            const __m256 heights = _mm256_set1_ps(stepHeight);
+            const __m256 inverseStep = _mm256_set1_ps(1.f / stepHeight);
+            const __m256 inverseRamp = _mm256_set1_ps(1.f / std::max(ramp, 1e-6f));
+            const __m256 flat = _mm256_set1_ps(1.f - ramp);
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 one = _mm256_set1_ps(1.f);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 steps = _mm256_mul_ps(_mm256_loadu_ps(row + i), inverseStep);
+                __m256 step = _mm256_floor_ps(steps);
+                __m256 slope = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(steps, step), flat), inverseRamp);
+                slope = _mm256_min_ps(_mm256_max_ps(slope, zero), one);
+                _mm256_storeu_ps(row + i, _mm256_mul_ps(_mm256_add_ps(step, slope), heights));
+            }
+            terraceRowScalar(row + i, count - i, stepHeight, ramp);
+        }
+
+        __attribute__((target("avx2")))
+        void clampRowAvx2(float *row, int count, float min, float max) {
+            const __m256 minVector = _mm256_set1_ps(min);
+            const __m256 maxVector = _mm256_set1_ps(max);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 height = _mm256_max_ps(_mm256_loadu_ps(row + i), minVector);
+                _mm256_storeu_ps(row + i, _mm256_min_ps(height, maxVector));
+            }
+            clampRowScalar(row + i, count - i, min, max);
+        }
+#endif
+
+        const FilterKernels scalarKernels{"scalar", thermalRowScalar, blurRowScalar, blurColumnScalar,
+                                          terraceRowScalar, clampRowScalar};
+
+        const FilterKernels &detect() {
+#ifdef PROCGEN_FILTER_AVX2
+            static const FilterKernels avx2Kernels{"avx2", thermalRowAvx2, blurRowAvx2, blurColumnAvx2,
+                                                   terraceRowAvx2, clampRowAvx2};
+            if (__builtin_cpu_supports("avx2")) {
+                return avx2Kernels;
+            }
+#endif
+            return scalarKernels;
+        }
+    }
+
+    const FilterKernels &scalar() {
+        return scalarKernels;
+    }
+
+    const FilterKernels &best() {
+        static const FilterKernels &kernels = detect();
+        return kernels;
+    }
+}
@@ -0,0 +1,62 @@
+
+#ifndef PROCGEN_FILTERKERNELS_H
+#define PROCGEN_FILTERKERNELS_H
+
+
+/**
+ * Row kernels for the height filters in HeightFilters. Each one works along a row of samples so a chain of them can
+ * run over a small tile that stays in cache. All implementations do the same float operations in the same order, with
+ * no fused multiply-adds, so they give bit identical results.
+ */
+namespace filter {
+    /**
+     * One step of thermal erosion: wherever the difference to a neighbour is steeper than the talus, the excess is
+     * moved across at the given rate. Pairs always move the same amount each way, so no material is lost.
+     * out[i] = row[i] - rate * sum(excess(row[i] - neighbour)) over row[i - 1], row[i + 1], above[i] and below[i],
+     * so row[-1] and row[count] have to be readable
+     */
+    typedef void (*ThermalRowFn)(const float *above, const float *row, const float *below, int count, float talus,
+                                 float rate, float *out);
+
+    /**
+     * Horizontal half of a separable blur: out[i] = sum(weights[k] * row[i + k - radius]) for k in [0, 2 * radius]
+     */
+    typedef void (*BlurRowFn)(const float *row, const float *weights, int radius, int count, float *out);
+
+    /**
+     * Vertical half of a separable blur: out[i] = sum(weights[k] * rows[k][i]) for k in [0, 2 * radius]
+     */
+    typedef void (*BlurColumnFn)(const float *const *rows, const float *weights, int radius, int count, float *out);
+
+    /**
+     * Flattens heights into steps in place, see expr::Terrace
+     */
+    typedef void (*TerraceRowFn)(float *row, int count, float stepHeight, float ramp);
+
+    /**
+     * Clamps heights to [min, max] in place
+     */
+    typedef void (*ClampRowFn)(float *row, int count, float min, float max);
+
+    struct FilterKernels {
+        const char *name;
+        ThermalRowFn thermalRow;
+        BlurRowFn blurRow;
+        BlurColumnFn blurColumn;
+        TerraceRowFn terraceRow;
+        ClampRowFn clampRow;
+    };
+
+    /**
+     * Plain C++ reference kernels
+     */
+    const FilterKernels &scalar();
+
+    /**
+     * The fastest kernels the current CPU supports, picked the first time this is called
+     */
+    const FilterKernels &best();
+}
+
+
+#endif //PROCGEN_FILTERKERNELS_H
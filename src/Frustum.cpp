@@ -0,0 +1,145 @@
+
+#include <algorithm>
+#include "Frustum.h"
+
+#if defined(__SSE__) || defined(__x86_64__)
+#define PROCGEN_FRUSTUM_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#define PROCGEN_FRUSTUM_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+    glm::vec4 matrixRow(const glm::mat4 &matrix, int row) {
+        return glm::vec4(matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]);
+    }
+
+    /**
+     * Distance to the plane from the corner of the box furthest along the plane's normal. If even that corner is
+     * behind the plane, the whole box is
+     */
+    float furthestDistance(const glm::vec4 &plane, const glm::vec3 &min, const glm::vec3 &max) {
+        return plane.x * (plane.x >= 0.f ? max.x : min.x) + plane.y * (plane.y >= 0.f ? max.y : min.y) +
+               plane.z * (plane.z >= 0.f ? max.z : min.z) + plane.w;
+    }
+}
+
+BoundingBox BoundingBox::transformed(const glm::mat4 &matrix) const {
+    // Arvo's method, each column of the matrix moves the box along an axis by whichever end is smaller/larger
+    glm::vec3 translation(matrix[3]);
+    BoundingBox result{translation, translation};
+    for (int column = 0; column < 3; ++column) {
+        glm::vec3 axis(matrix[column]);
+        glm::vec3 a = axis * min[column];
+        glm::vec3 b = axis * max[column];
+        result.min += glm::min(a, b);
+        result.max += glm::max(a, b);
+    }
+    return result;
+}
+
+void BoundingBoxes::add(const BoundingBox &box) {
+    minX.push_back(box.min.x);
+    minY.push_back(box.min.y);
+    minZ.push_back(box.min.z);
+    maxX.push_back(box.max.x);
+    maxY.push_back(box.max.y);
+    maxZ.push_back(box.max.z);
+}
+
+void BoundingBoxes::clear() {
+    minX.clear();
+    minY.clear();
+    minZ.clear();
+    maxX.clear();
+    maxY.clear();
+    maxZ.clear();
+}
+
+size_t BoundingBoxes::size() const {
+    return minX.size();
+}
+
+Frustum::Frustum(const glm::mat4 &viewProjection) {
+    // Gribb and Hartmann's extraction, a point is inside when -w <= x, y, z <= w in clip space
+    glm::vec4 x = matrixRow(viewProjection, 0);
+    glm::vec4 y = matrixRow(viewProjection, 1);
+    glm::vec4 z = matrixRow(viewProjection, 2);
+    glm::vec4 w = matrixRow(viewProjection, 3);
+    planes[0] = w + x; // Left
+    planes[1] = w - x; // Right
+    planes[2] = w + y; // Bottom
+    planes[3] = w - y; // Top
+    planes[4] = w + z; // Near
+    planes[5] = w - z; // Far
+
+    for (auto &plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+bool Frustum::isVisible(const BoundingBox &box) const {
+    for (const auto &plane : planes) {
+        if (furthestDistance(plane, box.min, box.max) < 0.f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t Frustum::cull(const BoundingBoxes &boxes, std::vector<unsigned char> &visible) const {
+    size_t count = boxes.size();
+    visible.resize(count);
+    size_t i = 0;
+
+#if defined(PROCGEN_FRUSTUM_SSE) || defined(PROCGEN_FRUSTUM_NEON)
+    // The corner to test against each plane only depends on the plane, so it's picked once for every box rather than
+    // per lane, leaving just multiplies, adds and a compare per plane
+    const float *furthest[6][3];
+    for (int p = 0; p < 6; ++p) {
+        furthest[p][0] = planes[p].x >= 0.f ? boxes.maxX.data() : boxes.minX.data();
+        furthest[p][1] = planes[p].y >= 0.f ? boxes.maxY.data() : boxes.minY.data();
+        furthest[p][2] = planes[p].z >= 0.f ? boxes.maxZ.data() : boxes.minZ.data();
+    }
+
+    for (; i + 4 <= count; i += 4) {
+#ifdef PROCGEN_FRUSTUM_SSE
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; ++p) {
+            __m128 distance = _mm_mul_ps(_mm_set1_ps(planes[p].x), _mm_loadu_ps(furthest[p][0] + i));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes[p].y), _mm_loadu_ps(furthest[p][1] + i)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes[p].z), _mm_loadu_ps(furthest[p][2] + i)));
+            distance = _mm_add_ps(distance, _mm_set1_ps(planes[p].w));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+        }
+        int mask = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; ++lane) {
+            visible[i + lane] = static_cast<unsigned char>(((mask >> lane) & 1) ^ 1);
+        }
+#else
+        uint32x4_t outside = vdupq_n_u32(0);
+        for (int p = 0; p < 6; ++p) {
+            float32x4_t distance = vmulq_n_f32(vld1q_f32(furthest[p][0] + i), planes[p].x);
+            distance = vaddq_f32(distance, vmulq_n_f32(vld1q_f32(furthest[p][1] + i), planes[p].y));
+            distance = vaddq_f32(distance, vmulq_n_f32(vld1q_f32(furthest[p][2] + i), planes[p].z));
+            distance = vaddq_f32(distance, vdupq_n_f32(planes[p].w));
+            outside = vorrq_u32(outside, vcltq_f32(distance, vdupq_n_f32(0.f)));
+        }
+        uint32_t lanes[4];
+        vst1q_u32(lanes, outside);
+        for (int lane = 0; lane < 4; ++lane) {
+            visible[i + lane] = lanes[lane] == 0 ? 1 : 0;
+        }
+#endif
+    }
+#endif
+
+    // Whatever doesn't fill a whole group of four
+    for (; i < count; ++i) {
+        BoundingBox box{{boxes.minX[i], boxes.minY[i], boxes.minZ[i]}, {boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]}};
+        visible[i] = isVisible(box) ? 1 : 0;
+    }
+
+    return static_cast<size_t>(std::count(visible.begin(), visible.end(), 0));
+}
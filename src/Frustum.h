@@ -0,0 +1,68 @@
+
+#ifndef PROCGEN_FRUSTUM_H
+#define PROCGEN_FRUSTUM_H
+
+
+#include <cstddef>
+#include <glm.hpp>
+#include <vector>
+
+/**
+ * Axis aligned box in world space
+ */
+struct BoundingBox {
+    glm::vec3 min;
+    glm::vec3 max;
+
+    /**
+     * @return Smallest axis aligned box holding this box after it's been transformed
+     */
+    BoundingBox transformed(const glm::mat4 &matrix) const;
+};
+
+/**
+ * Many boxes stored a component at a time, so they can be tested several at once
+ */
+struct BoundingBoxes {
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+
+    void add(const BoundingBox &box);
+
+    void clear();
+
+    size_t size() const;
+};
+
+struct CullStats {
+    size_t tested = 0;
+    size_t culled = 0;
+};
+
+/**
+ * The six planes of a view frustum, normals pointing inwards.
+ * Boxes are only culled when they're entirely outside one plane, so a few boxes near the corners of the frustum are
+ * kept even though they can't be seen. That's fine for culling, it never drops anything visible
+ */
+class Frustum {
+private:
+    glm::vec4 planes[6];
+
+public:
+    /**
+     * @param viewProjection Projection matrix times view matrix, planes come out in world space
+     */
+    explicit Frustum(const glm::mat4 &viewProjection);
+
+    bool isVisible(const BoundingBox &box) const;
+
+    /**
+     * Tests many boxes at once, four at a time with SIMD where it's available
+     * @param visible Set to 1 for each box that might be visible and 0 for each box that's culled
+     * @return Number of boxes culled
+     */
+    size_t cull(const BoundingBoxes &boxes, std::vector<unsigned char> &visible) const;
+};
+
+
+#endif //PROCGEN_FRUSTUM_H
@@ -0,0 +1,39 @@
+
+#ifndef PROCGEN_HASH_H
+#define PROCGEN_HASH_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * 64 bit FNV-1a over the bytes of whatever's added. Used to key cached data by everything that went into making it,
+ * so it only has to be stable and spread well, not be hard to reverse
+ */
+class Hasher {
+private:
+    uint64_t state = 0xcbf29ce484222325ull;
+
+public:
+    Hasher &add(const void *data, size_t bytes) {
+        auto *values = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < bytes; ++i) {
+            state = (state ^ values[i]) * 0x100000001b3ull;
+        }
+        return *this;
+    }
+
+    template<typename T>
+    Hasher &add(const T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be hashed byte by byte");
+        return add(&value, sizeof(T));
+    }
+
+    uint64_t get() const {
+        return state;
+    }
+};
+
+
+#endif //PROCGEN_HASH_H
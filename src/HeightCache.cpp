@@ -0,0 +1,146 @@
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "HeightCache.h"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+    struct CacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t size;
+        uint32_t reserved;
+    };
+
+    const char cacheMagic[4] = {'P', 'G', 'H', 'C'};
+}
+
+HeightCache::HeightCache(std::string directory) : directory(std::move(directory)) {
+    // Fails harmlessly if it's already there
+#ifdef _WIN32
+    _mkdir(HeightCache::directory.c_str());
+#else
+    mkdir(HeightCache::directory.c_str(), 0755);
+#endif
+}
+
+std::string HeightCache::getPath(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.heights", static_cast<unsigned long long>(key));
+    return directory + "/" + name;
+}
+
+bool HeightCache::load(uint64_t key, HeightField &field) {
+    MappedFile file(getPath(key));
+    size_t size = field.getSize();
+    size_t bytes = size * size * sizeof(float);
+    CacheHeader header{};
+    if (file.isOpen() && file.getSize() == sizeof(CacheHeader) + bytes) {
+        memcpy(&header, file.getData(), sizeof(CacheHeader));
+    }
+    if (memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != HEIGHT_CACHE_VERSION ||
+        header.key != key || header.size != size) {
+        ++misses;
+        return false;
+    }
+
+    const unsigned char *heights = file.getData() + sizeof(CacheHeader);
+    if (field.getLayout() == HeightLayout::RowMajor) {
+        memcpy(field.getData(), heights, bytes);
+    } else {
+        field.forEach([&](int x, int y, float &height) {
+            memcpy(&height, heights + (size * y + x) * sizeof(float), sizeof(float));
+        });
+    }
+    ++hits;
+    return true;
+}
+
+void HeightCache::store(uint64_t key, const HeightField &field) {
+    unsigned int size = field.getSize();
+    CacheHeader header{};
+    memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = HEIGHT_CACHE_VERSION;
+    header.key = key;
+    header.size = size;
+
+    std::vector<float> heights;
+    const float *data = field.getData();
+    if (field.getLayout() != HeightLayout::RowMajor) {
+        heights.resize(static_cast<size_t>(size) * size);
+        field.forEach([&](int x, int y, float height) {
+            heights[static_cast<size_t>(size) * y + x] = height;
+        });
+        data = heights.data();
+    }
+
+    // Unique to this thread and moment, so threads and processes storing the same key don't write over each other
+    std::ostringstream temporary;
+    temporary << getPath(key) << '.' << std::hash<std::thread::id>()(std::this_thread::get_id()) << '.'
+              << std::chrono::steady_clock::now().time_since_epoch().count();
+    {
+        std::ofstream out(temporary.str(), std::ios::binary);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(data),
+                  static_cast<std::streamsize>(static_cast<size_t>(size) * size * sizeof(float)));
+        if (!out) {
+            std::cerr << "Failed to write cached heights to " << temporary.str() << std::endl;
+            out.close();
+            std::remove(temporary.str().c_str());
+            return;
+        }
+    }
+    if (std::rename(temporary.str().c_str(), getPath(key).c_str()) != 0) {
+        // Someone else got there first on a platform where rename won't replace, their file is just as good
+        std::remove(temporary.str().c_str());
+    }
+}
+
+unsigned int HeightCache::getHits() const {
+    return hits;
+}
+
+unsigned int HeightCache::getMisses() const {
+    return misses;
+}
+
+CachedGenerator::CachedGenerator(std::shared_ptr<const HeightGenerator> generator, std::shared_ptr<HeightCache> cache)
+        : generator(std::move(generator)), cache(std::move(cache)) {}
+
+uint64_t CachedGenerator::getKey(unsigned int size, int originX, int originY) const {
+    Hasher hasher;
+    hasher.add(HEIGHT_CACHE_VERSION);
+    generator->hash(hasher);
+    return hasher.add(size).add(originX).add(originY).get();
+}
+
+void CachedGenerator::generate(HeightField &field, int originX, int originY) const {
+    uint64_t key = getKey(field.getSize(), originX, originY);
+    if (cache->load(key, field)) {
+        return;
+    }
+    generator->generate(field, originX, originY);
+    cache->store(key, field);
+}
+
+float CachedGenerator::getHeightScale() const {
+    return generator->getHeightScale();
+}
+
+void CachedGenerator::hash(Hasher &hasher) const {
+    generator->hash(hasher);
+}
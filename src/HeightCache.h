@@ -0,0 +1,74 @@
+
+#ifndef PROCGEN_HEIGHTCACHE_H
+#define PROCGEN_HEIGHTCACHE_H
+
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "HeightGenerator.h"
+
+// Part of every key. Bump it whenever a change to generation code changes the heights it makes, so old files are
+// never used again
+#define HEIGHT_CACHE_VERSION 1
+
+/**
+ * Generated heights stored on disk under a hash of everything that went into them. A file is a small header followed
+ * by the heights as row major floats, so on a hit the file is mapped and copied straight into the field.
+ * Safe to use from several threads at once, files are written under a temporary name and renamed into place so
+ * nothing ever reads half a file
+ */
+class HeightCache {
+private:
+    std::string directory;
+    std::atomic<unsigned int> hits{0};
+    std::atomic<unsigned int> misses{0};
+
+    std::string getPath(uint64_t key) const;
+
+public:
+    /**
+     * @param directory Where the files go, created if it doesn't exist
+     */
+    explicit HeightCache(std::string directory);
+
+    /**
+     * Fills the field with the heights stored under the key
+     * @return False if there's no file for the key or it doesn't match the field, leaving the field as it was
+     */
+    bool load(uint64_t key, HeightField &field);
+
+    void store(uint64_t key, const HeightField &field);
+
+    unsigned int getHits() const;
+
+    unsigned int getMisses() const;
+};
+
+/**
+ * Looks heights up in a cache before generating them, and stores them after. Keyed by the generator's hash, the field
+ * size, the origin and HEIGHT_CACHE_VERSION, so changing anything about the world just misses
+ */
+class CachedGenerator : public HeightGenerator {
+private:
+    std::shared_ptr<const HeightGenerator> generator;
+    std::shared_ptr<HeightCache> cache;
+
+public:
+    CachedGenerator(std::shared_ptr<const HeightGenerator> generator, std::shared_ptr<HeightCache> cache);
+
+    void generate(HeightField &field, int originX = 0, int originY = 0) const override;
+
+    float getHeightScale() const override;
+
+    void hash(Hasher &hasher) const override;
+
+    /**
+     * @return The key the heights for a field of this size at this origin are stored under
+     */
+    uint64_t getKey(unsigned int size, int originX, int originY) const;
+};
+
+
+#endif //PROCGEN_HEIGHTCACHE_H
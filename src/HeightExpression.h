@@ -0,0 +1,343 @@
+
+#ifndef PROCGEN_HEIGHTEXPRESSION_H
+#define PROCGEN_HEIGHTEXPRESSION_H
+
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include "HeightGenerator.h"
+#include "NoiseGenerator.h"
+
+// Samples evaluated together. Every node works on a whole batch in a fixed length loop the compiler can unroll and
+// vectorise, and the batch is small enough that all the temporaries stay in L1
+#define EXPRESSION_BATCH 32
+static_assert(EXPRESSION_BATCH <= NOISE_MAX_POINTS, "Fractal nodes evaluate a whole batch of points at once");
+
+/**
+ * Height functions built out of templates, e.g. "ridged fBm * mask + warp". The whole tree is one type, so the
+ * compiler sees every node and inlines them into a single loop per batch. Nothing is virtual below the generator.
+ *
+ * Each node has evaluate(x, y, out), which fills out with the height at EXPRESSION_BATCH points given in world samples,
+ * and hash(hasher), which adds the node and everything under it so generated heights can be cached.
+ * Build trees with the functions and operators below rather than naming the node types:
+ *
+ *     auto mountains = expr::fractal(seed, ridgedSettings) * expr::fractal(seed + 1, maskSettings);
+ *     auto height = expr::warp(mountains, expr::fractal(seed + 2, warpSettings), expr::fractal(seed + 3, warpSettings),
+ *                              8.f);
+ *     auto generator = expr::makeGenerator(expr::clamp(height, -4.f, 10.f), 10.f);
+ */
+namespace expr {
+    /**
+     * Base of every node, only used to pick out node types for the operators
+     */
+    template<typename Derived>
+    struct Expression {
+        const Derived &self() const {
+            return static_cast<const Derived &>(*this);
+        }
+    };
+
+    struct Constant : Expression<Constant> {
+        float value;
+
+        explicit Constant(float value) : value(value) {}
+
+        void hash(Hasher &hasher) const {
+            hasher.add("Constant").add(value);
+        }
+
+        void evaluate(const float *, const float *, float *out) const {
+            for (int i = 0; i < EXPRESSION_BATCH; ++i) {
+                out[i] = value;
+            }
+        }
+    };
+
+    /**
+     * fBm, ridged or billow noise, evaluated a batch at a time with the SIMD noise kernels
+     */
+    struct Fractal : Expression<Fractal> {
+        NoiseGenerator generator;
+
+        Fractal(unsigned int seed, const NoiseSettings &settings) : generator(seed, settings) {}
+
+        void hash(Hasher &hasher) const {
+            generator.hash(hasher);
+        }
+
+        void evaluate(const float *x, const float *y, float *out) const {
+            generator.generatePoints(x, y, EXPRESSION_BATCH, out);
+        }
+    };
+
+    template<typename A, typename B>
+    struct Add : Expression<Add<A, B>> {
+        A a;
+        B b;
+
+        Add(const A &a, const B &b) : a(a), b(b) {}
+
+        void hash(Hasher &hasher) const {
+            hasher.add("Add");
+            a.hash(hasher);
+            b.hash(hasher);
+        }
+
+        void evaluate(const float *x, const float *y, float *out) const {
+            float other[EXPRESSION_BATCH];
+            a.evaluate(x, y, out);
+            b.evaluate(x, y, other);
+            for (int i = 0; i < EXPRESSION_BATCH; ++i) {
+                out[i] += other[i];
+            }
+        }
+    };
+
+    template<typename A, typename B>
+    struct Mul : Expression<Mul<A, B>> {
+        A a;
+        B b;
+
+        Mul(const A &a, const B &b) : a(a), b(b) {}
+
+        void hash(Hasher &hasher) const {
+            hasher.add("Mul");
+            a.hash(hasher);
+            b.hash(hasher);
+        }
+
+        void evaluate(const float *x, const float *y, float *out) const {
+            float other[EXPRESSION_BATCH];
+            a.evaluate(x, y, out);
+            b.evaluate(x, y, other);
+            for (int i = 0; i < EXPRESSION_BATCH; ++i) {
+                out[i] *= other[i];
+            }
+        }
+    };
+
+    /**
+     * Domain warp: looks the source up at (x + strength * warpX(x, y), y + strength * warpY(x, y))
+     */
+    template<typename Source, typename WarpX, typename WarpY>
+    struct Warp : Expression<Warp<Source, WarpX, WarpY>> {
+        Source source;
+        WarpX warpX;
+        WarpY warpY;
+        float strength;
+
+        Warp(const Source &source, const WarpX &warpX, const WarpY &warpY, float strength)
+                : source(source), warpX(warpX), warpY(warpY), strength(strength) {}
+
+        void hash(Hasher &hasher) const {
+            hasher.add("Warp").add(strength);
+            source.hash(hasher);
+            warpX.hash(hasher);
+            warpY.hash(hasher);
+        }
+
+        void evaluate(const float *x, const float *y, float *out) const {
+            float offsetX[EXPRESSION_BATCH];
+            float offsetY[EXPRESSION_BATCH];
+            warpX.evaluate(x, y, offsetX);
+            warpY.evaluate(x, y, offsetY);
+            for (int i = 0; i < EXPRESSION_BATCH; ++i) {
+                offsetX[i] = x[i] + offsetX[i] * strength;
+                offsetY[i] = y[i] + offsetY[i] * strength;
+            }
+            source.evaluate(offsetX, offsetY, out);
+        }
+    };
+
+    template<typename A>
+    struct Clamp : Expression<Clamp<A>> {
+        A a;
+        float min, max;
+
+        Clamp(const A &a, float min, float max) : a(a), min(min), max(max) {}
+
+        void hash(Hasher &hasher) const {
+            hasher.add("Clamp").add(min).add(max);
+            a.hash(hasher);
+        }
+
+        void evaluate(const float *x, const float *y, float *out) const {
+            a.evaluate(x, y, out);
+            for (int i = 0; i < EXPRESSION_BATCH; ++i) {
+                out[i] = std::min(std::max(out[i], min), max);
+            }
+        }
+    };
+
+    /**
+     * Flattens heights into steps of the given height. The last ramp fraction of each step slopes up to the next
+     * one, 0 gives sheer cliffs and 1 leaves the heights as they were
+     */
+    template<typename A>
+    struct Terrace : Expression<Terrace<A>> {
+        A a;
+        float stepHeight;
+        float ramp;
+
+        Terrace(const A &a, float stepHeight, float ramp) : a(a), stepHeight(stepHeight), ramp(ramp) {}
+
+        void hash(Hasher &hasher) const {
+            hasher.add("Terrace").add(stepHeight).add(ramp);
+            a.hash(hasher);
+        }
+
+        void evaluate(const float *x, const float *y, float *out) const {
+            a.evaluate(x, y, out);
+            float inverseStep = 1.f / stepHeight;
+            float inverseRamp = 1.f / std::max(ramp, 1e-6f);
+            for (int i = 0; i < EXPRESSION_BATCH; ++i) {
+                float steps = out[i] * inverseStep;
+                float step = std::floor(steps);
+                float slope = std::min(std::max((steps - step - (1.f - ramp)) * inverseRamp, 0.f), 1.f);
+                out[i] = (step + slope) * stepHeight;
+            }
+        }
+    };
+
+    /**
+     * Picks a where the condition is below the threshold and b above it, blending between them over falloff either
+     * side. Both sides are always evaluated, which keeps the loop free of branches
+     */
+    template<typename Condition, typename A, typename B>
+    struct Select : Expression<Select<Condition, A, B>> {
+        Condition condition;
+        A a;
+        B b;
+        float threshold;
+        float falloff;
+
+        Select(const Condition &condition, const A &a, const B &b, float threshold, float falloff)
+                : condition(condition), a(a), b(b), threshold(threshold), falloff(falloff) {}
+
+        void hash(Hasher &hasher) const {
+            hasher.add("Select").add(threshold).add(falloff);
+            condition.hash(hasher);
+            a.hash(hasher);
+            b.hash(hasher);
+        }
+
+        void evaluate(const float *x, const float *y, float *out) const {
+            float blend[EXPRESSION_BATCH];
+            float other[EXPRESSION_BATCH];
+            condition.evaluate(x, y, blend);
+            a.evaluate(x, y, out);
+            b.evaluate(x, y, other);
+            float start = threshold - falloff;
+            float inverseWidth = 1.f / std::max(falloff * 2.f, 1e-6f);
+            for (int i = 0; i < EXPRESSION_BATCH; ++i) {
+                float t = std::min(std::max((blend[i] - start) * inverseWidth, 0.f), 1.f);
+                out[i] += (other[i] - out[i]) * t;
+            }
+        }
+    };
+
+    inline Fractal fractal(unsigned int seed, const NoiseSettings &settings) {
+        return Fractal(seed, settings);
+    }
+
+    template<typename S, typename X, typename Y>
+    Warp<S, X, Y> warp(const Expression<S> &source, const Expression<X> &warpX, const Expression<Y> &warpY,
+                       float strength) {
+        return Warp<S, X, Y>(source.self(), warpX.self(), warpY.self(), strength);
+    }
+
+    template<typename A>
+    Clamp<A> clamp(const Expression<A> &a, float min, float max) {
+        return Clamp<A>(a.self(), min, max);
+    }
+
+    template<typename A>
+    Terrace<A> terrace(const Expression<A> &a, float stepHeight, float ramp) {
+        return Terrace<A>(a.self(), stepHeight, ramp);
+    }
+
+    template<typename C, typename A, typename B>
+    Select<C, A, B> select(const Expression<C> &condition, const Expression<A> &a, const Expression<B> &b,
+                           float threshold, float falloff) {
+        return Select<C, A, B>(condition.self(), a.self(), b.self(), threshold, falloff);
+    }
+
+    template<typename A, typename B>
+    Add<A, B> operator+(const Expression<A> &a, const Expression<B> &b) {
+        return Add<A, B>(a.self(), b.self());
+    }
+
+    template<typename A>
+    Add<A, Constant> operator+(const Expression<A> &a, float b) {
+        return Add<A, Constant>(a.self(), Constant(b));
+    }
+
+    template<typename A, typename B>
+    Mul<A, B> operator*(const Expression<A> &a, const Expression<B> &b) {
+        return Mul<A, B>(a.self(), b.self());
+    }
+
+    template<typename A>
+    Mul<A, Constant> operator*(const Expression<A> &a, float b) {
+        return Mul<A, Constant>(a.self(), Constant(b));
+    }
+
+    /**
+     * Feeds an expression into anything that takes a HeightGenerator, like Terrain and ChunkManager.
+     * The one virtual call is per field, each row is then evaluated a batch at a time
+     */
+    template<typename E>
+    class ExpressionGenerator : public HeightGenerator {
+    private:
+        E expression;
+        float heightScale;
+
+    public:
+        ExpressionGenerator(const E &expression, float heightScale)
+                : expression(expression), heightScale(heightScale) {}
+
+        /**
+         * Heights for one row of the world: out[i] is the height at (x + i, y)
+         */
+        void generateRow(int x, int y, int count, float *out) const {
+            float pointX[EXPRESSION_BATCH];
+            float pointY[EXPRESSION_BATCH];
+            float heights[EXPRESSION_BATCH];
+            std::fill(pointY, pointY + EXPRESSION_BATCH, static_cast<float>(y));
+            for (int start = 0; start < count; start += EXPRESSION_BATCH) {
+                // The last batch runs past the end of the row, those samples are worked out and thrown away
+                for (int i = 0; i < EXPRESSION_BATCH; ++i) {
+                    pointX[i] = static_cast<float>(x + start + i);
+                }
+                expression.evaluate(pointX, pointY, heights);
+                std::copy(heights, heights + std::min(EXPRESSION_BATCH, count - start), out + start);
+            }
+        }
+
+        void generate(HeightField &field, int originX = 0, int originY = 0) const override {
+            generateRows(field, originX, originY, [this](int x, int y, int count, float *out) {
+                generateRow(x, y, count, out);
+            });
+        }
+
+        float getHeightScale() const override {
+            return heightScale;
+        }
+
+        void hash(Hasher &hasher) const override {
+            expression.hash(hasher);
+        }
+    };
+
+    /**
+     * @param heightScale Rough height either side of zero the expression reaches, see HeightGenerator::getHeightScale
+     */
+    template<typename E>
+    std::shared_ptr<ExpressionGenerator<E>> makeGenerator(const Expression<E> &expression, float heightScale) {
+        return std::make_shared<ExpressionGenerator<E>>(expression.self(), heightScale);
+    }
+}
+
+
+#endif //PROCGEN_HEIGHTEXPRESSION_H
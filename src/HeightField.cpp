@@ -0,0 +1,85 @@
+
+#include <algorithm>
+#include <cmath>
+#include "HeightField.h"
+
+namespace {
+    // Spreads the low 4 bits out to every other bit
+    unsigned int spreadBits(unsigned int value) {
+        value = (value | (value << 2)) & 0x33;
+        return (value | (value << 1)) & 0x55;
+    }
+}
+
+HeightField::HeightField(unsigned int size, HeightLayout layout)
+        : size(size), layout(layout), tilesPerRow((size + HEIGHT_TILE_SIZE - 1) / HEIGHT_TILE_SIZE) {
+    if (layout == HeightLayout::RowMajor) {
+        heights.resize(static_cast<size_t>(size) * size, 0.f);
+    } else {
+        // Pad out to whole tiles
+        size_t tileArea = HEIGHT_TILE_SIZE * HEIGHT_TILE_SIZE;
+        heights.resize(static_cast<size_t>(tilesPerRow) * tilesPerRow * tileArea, 0.f);
+
+        // The Morton index within a tile interleaves the bits of x and y, so it splits into separate x and y parts
+        columnOffsets.resize(size);
+        rowOffsets.resize(size);
+        for (unsigned int i = 0; i < size; ++i) {
+            auto tile = static_cast<size_t>(i >> HEIGHT_TILE_SHIFT);
+            auto morton = spreadBits(i & (HEIGHT_TILE_SIZE - 1));
+            columnOffsets[i] = tile * tileArea + morton;
+            rowOffsets[i] = tile * tilesPerRow * tileArea + (morton << 1);
+        }
+    }
+}
+
+float *HeightField::getData() {
+    return heights.data();
+}
+
+const float *HeightField::getData() const {
+    return heights.data();
+}
+
+size_t HeightField::getDataSize() const {
+    return heights.size();
+}
+
+unsigned int HeightField::getSize() const {
+    return size;
+}
+
+HeightLayout HeightField::getLayout() const {
+    return layout;
+}
+
+void HeightField::getRange(float &minY, float &maxY) const {
+    if (layout == HeightLayout::RowMajor) {
+        auto range = std::minmax_element(heights.begin(), heights.end());
+        minY = *range.first;
+        maxY = *range.second;
+        return;
+    }
+
+    // Skip the padding
+    minY = at(0, 0);
+    maxY = minY;
+    forEach([&](int, int, float height) {
+        minY = std::min(minY, height);
+        maxY = std::max(maxY, height);
+    });
+}
+
+float HeightField::sample(float x, float y) const {
+    float last = static_cast<float>(size - 1);
+    x = std::min(std::max(x, 0.f), last);
+    y = std::min(std::max(y, 0.f), last);
+
+    int x0 = std::min(static_cast<int>(x), static_cast<int>(size) - 2);
+    int y0 = std::min(static_cast<int>(y), static_cast<int>(size) - 2);
+    float tx = x - static_cast<float>(x0);
+    float ty = y - static_cast<float>(y0);
+
+    float top = at(x0, y0) + (at(x0 + 1, y0) - at(x0, y0)) * tx;
+    float bottom = at(x0, y0 + 1) + (at(x0 + 1, y0 + 1) - at(x0, y0 + 1)) * tx;
+    return top + (bottom - top) * ty;
+}
@@ -0,0 +1,143 @@
+
+#ifndef PROCGEN_HEIGHTFIELD_H
+#define PROCGEN_HEIGHTFIELD_H
+
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#define HEIGHT_TILE_SHIFT 4
+#define HEIGHT_TILE_SIZE (1 << HEIGHT_TILE_SHIFT)
+
+enum class HeightLayout {
+    RowMajor, // data[size * y + x]
+    Tiled // 16x16 tiles stored row by row, samples within a tile in Z-order (Morton) order
+};
+
+/**
+ * Square grid of heights stored as contiguous floats.
+ * Generation, normals and queries all work on this rather than on the vertex data that gets sent to OpenGL.
+ * The tiled layout keeps samples that are close in 2D close in memory, which helps the coarse diamond-square levels on
+ * large maps, but rows are no longer contiguous so row() is only available for the row major layout.
+ */
+class HeightField {
+private:
+    unsigned int size;
+    HeightLayout layout;
+    unsigned int tilesPerRow;
+    std::vector<float> heights;
+    // Tiled layout offsets for each column and row, index(x, y) = columnOffsets[x] + rowOffsets[y]
+    std::vector<size_t> columnOffsets;
+    std::vector<size_t> rowOffsets;
+
+public:
+    explicit HeightField(unsigned int size, HeightLayout layout = HeightLayout::RowMajor);
+
+    /**
+     * @return Offset of the sample in the underlying storage
+     */
+    size_t index(int x, int y) const {
+        assert(x >= 0 && x < static_cast<int>(size));
+        assert(y >= 0 && y < static_cast<int>(size));
+        if (layout == HeightLayout::RowMajor) {
+            return static_cast<size_t>(size) * y + x;
+        }
+        return columnOffsets[x] + rowOffsets[y];
+    }
+
+    float &at(int x, int y) {
+        return heights[index(x, y)];
+    }
+
+    float at(int x, int y) const {
+        return heights[index(x, y)];
+    }
+
+    float *row(int y) {
+        assert(layout == HeightLayout::RowMajor);
+        return &heights[static_cast<size_t>(size) * y];
+    }
+
+    const float *row(int y) const {
+        assert(layout == HeightLayout::RowMajor);
+        return &heights[static_cast<size_t>(size) * y];
+    }
+
+    /**
+     * Calls func(x, y, height) for every sample, following the storage layout (row by row, or a tile at a time).
+     * Tiles that hang over the edge of the field are clipped, so padding is never visited
+     */
+    template<typename F>
+    void forEach(F func) {
+        forEachIn(0, 0, size, size, func);
+    }
+
+    template<typename F>
+    void forEach(F func) const {
+        forEachIn(0, 0, size, size, func);
+    }
+
+    /**
+     * Calls func(x, y, height) for every sample in [x0, x1) x [y0, y1), visiting a tile at a time in the tiled layout
+     */
+    template<typename F>
+    void forEachIn(int x0, int y0, int x1, int y1, F func) {
+        if (layout == HeightLayout::RowMajor) {
+            for (int y = y0; y < y1; ++y) {
+                float *values = row(y);
+                for (int x = x0; x < x1; ++x) {
+                    func(x, y, values[x]);
+                }
+            }
+            return;
+        }
+        for (int tileY = y0 & ~(HEIGHT_TILE_SIZE - 1); tileY < y1; tileY += HEIGHT_TILE_SIZE) {
+            for (int tileX = x0 & ~(HEIGHT_TILE_SIZE - 1); tileX < x1; tileX += HEIGHT_TILE_SIZE) {
+                int yEnd = tileY + HEIGHT_TILE_SIZE < y1 ? tileY + HEIGHT_TILE_SIZE : y1;
+                int xEnd = tileX + HEIGHT_TILE_SIZE < x1 ? tileX + HEIGHT_TILE_SIZE : x1;
+                for (int y = tileY > y0 ? tileY : y0; y < yEnd; ++y) {
+                    for (int x = tileX > x0 ? tileX : x0; x < xEnd; ++x) {
+                        func(x, y, at(x, y));
+                    }
+                }
+            }
+        }
+    }
+
+    template<typename F>
+    void forEachIn(int x0, int y0, int x1, int y1, F func) const {
+        const_cast<HeightField *>(this)->forEachIn(x0, y0, x1, y1, [&func](int x, int y, float &height) {
+            func(x, y, height);
+        });
+    }
+
+    /**
+     * Raw storage. Includes padding in the tiled layout
+     */
+    float *getData();
+
+    const float *getData() const;
+
+    size_t getDataSize() const;
+
+    /**
+     * @return Number of samples along one side
+     */
+    unsigned int getSize() const;
+
+    HeightLayout getLayout() const;
+
+    /**
+     * Finds the lowest and highest height in the field
+     */
+    void getRange(float &minY, float &maxY) const;
+
+    /**
+     * Bilinearly interpolates the height at a position in grid space, clamped to the edges
+     */
+    float sample(float x, float y) const;
+};
+
+
+#endif //PROCGEN_HEIGHTFIELD_H
@@ -0,0 +1,192 @@
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <utility>
+#include "HeightFilters.h"
+#include "ThreadPool.h"
+
+FilterChain::FilterChain() : filterKernels(&filter::best()) {}
+
+void FilterChain::setKernels(const filter::FilterKernels &filterKernels) {
+    FilterChain::filterKernels = &filterKernels;
+}
+
+int FilterChain::getHalo() const {
+    return halo;
+}
+
+void FilterChain::hash(Hasher &hasher) const {
+    hasher.add("FilterChain").add(stages.size());
+    for (const auto &stage : stages) {
+        hasher.add(stage.type).add(stage.radius).add(stage.a).add(stage.b);
+        hasher.add(stage.weights.data(), stage.weights.size() * sizeof(float));
+    }
+}
+
+void FilterChain::addThermal(int iterations, float talus, float rate) {
+    if (rate <= 0.f || rate > .25f) {
+        // Any faster and a sample can give away more than it's above its neighbours, which oscillates
+        std::cerr << "Thermal erosion rate must be in (0, .25], got " << rate << std::endl;
+        rate = std::min(std::max(rate, .01f), .25f);
+    }
+    for (int i = 0; i < iterations; ++i) {
+        stages.push_back({StageType::Thermal, 1, talus, rate, {}});
+        halo += 1;
+    }
+}
+
+void FilterChain::addBlur(float sigma) {
+    if (sigma <= 0.f) {
+        std::cerr << "Blur sigma must be positive, got " << sigma << std::endl;
+        return;
+    }
+    int radius = std::max(static_cast<int>(std::ceil(sigma * 3.f)), 1);
+    std::vector<float> weights(radius * 2 + 1);
+    float total = 0.f;
+    for (int k = -radius; k <= radius; ++k) {
+        weights[k + radius] = std::exp(-static_cast<float>(k * k) / (2.f * sigma * sigma));
+        total += weights[k + radius];
+    }
+    for (auto &weight : weights) {
+        weight /= total;
+    }
+    stages.push_back({StageType::Blur, radius, 0.f, 0.f, std::move(weights)});
+    halo += radius;
+}
+
+void FilterChain::addTerrace(float stepHeight, float ramp) {
+    if (stepHeight <= 0.f) {
+        std::cerr << "Terrace step height must be positive, got " << stepHeight << std::endl;
+        return;
+    }
+    stages.push_back({StageType::Terrace, 0, stepHeight, ramp, {}});
+}
+
+void FilterChain::addClamp(float min, float max) {
+    stages.push_back({StageType::Clamp, 0, min, max, {}});
+}
+
+void FilterChain::filterTile(const HeightField &field, HeightField &result, int tileX, int tileY) const {
+    int size = static_cast<int>(field.getSize());
+    int x0 = tileX * FILTER_TILE_SIZE, y0 = tileY * FILTER_TILE_SIZE;
+    int x1 = std::min(x0 + FILTER_TILE_SIZE, size), y1 = std::min(y0 + FILTER_TILE_SIZE, size);
+
+    // The buffers cover the tile plus the halo, anything past the edge of the field is a copy of the nearest edge
+    int left = x0 - halo, top = y0 - halo;
+    int width = x1 - x0 + halo * 2, height = y1 - y0 + halo * 2;
+    std::vector<float> original(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        int fieldY = std::min(std::max(top + y, 0), size - 1);
+        float *out = &original[static_cast<size_t>(width) * y];
+        if (field.getLayout() == HeightLayout::RowMajor) {
+            const float *row = field.row(fieldY);
+            for (int x = 0; x < width; ++x) {
+                out[x] = row[std::min(std::max(left + x, 0), size - 1)];
+            }
+            continue;
+        }
+        for (int x = 0; x < width; ++x) {
+            out[x] = field.at(std::min(std::max(left + x, 0), size - 1), fieldY);
+        }
+    }
+    std::vector<float> current = original;
+    std::vector<float> next(current.size());
+    std::vector<float> blurred(current.size());
+
+    // Buffer rows and columns outside [first, last) lie on or past the edge of the field, and go back to their
+    // original heights after every stage. That keeps the field's edges fixed, like running each filter on its own
+    int firstX = std::max(1 - left, 0), lastX = std::min(size - 1 - left, width);
+    int firstY = std::max(1 - top, 0), lastY = std::min(size - 1 - top, height);
+    bool touchesEdge = firstX > 0 || firstY > 0 || lastX < width || lastY < height;
+    auto restoreEdges = [&](int margin) {
+        if (!touchesEdge) {
+            return;
+        }
+        for (int y = margin; y < height - margin; ++y) {
+            size_t row = static_cast<size_t>(width) * y;
+            if (y < firstY || y >= lastY) {
+                std::copy(&original[row + margin], &original[row + width - margin], &current[row + margin]);
+                continue;
+            }
+            for (int x = margin; x < std::min(firstX, width - margin); ++x) {
+                current[row + x] = original[row + x];
+            }
+            for (int x = std::max(lastX, margin); x < width - margin; ++x) {
+                current[row + x] = original[row + x];
+            }
+        }
+    };
+
+    // Samples within margin of the buffer's edge are out of date, the margin grows by each stage's radius
+    int margin = 0;
+    std::vector<const float *> rows;
+    for (const auto &stage : stages) {
+        int start = margin + stage.radius;
+        int count = width - start * 2;
+        switch (stage.type) {
+            case StageType::Thermal:
+                for (int y = start; y < height - start; ++y) {
+                    const float *row = &current[static_cast<size_t>(width) * y + start];
+                    filterKernels->thermalRow(row - width, row, row + width, count, stage.a, stage.b,
+                                              &next[static_cast<size_t>(width) * y + start]);
+                }
+                std::swap(current, next);
+                break;
+            case StageType::Blur:
+                for (int y = margin; y < height - margin; ++y) {
+                    filterKernels->blurRow(&current[static_cast<size_t>(width) * y + start], stage.weights.data(),
+                                           stage.radius, count, &blurred[static_cast<size_t>(width) * y + start]);
+                }
+                for (int y = start; y < height - start; ++y) {
+                    rows.clear();
+                    for (int k = -stage.radius; k <= stage.radius; ++k) {
+                        rows.push_back(&blurred[static_cast<size_t>(width) * (y + k) + start]);
+                    }
+                    filterKernels->blurColumn(rows.data(), stage.weights.data(), stage.radius, count,
+                                              &next[static_cast<size_t>(width) * y + start]);
+                }
+                std::swap(current, next);
+                break;
+            case StageType::Terrace:
+                for (int y = start; y < height - start; ++y) {
+                    filterKernels->terraceRow(&current[static_cast<size_t>(width) * y + start], count, stage.a,
+                                              stage.b);
+                }
+                break;
+            case StageType::Clamp:
+                for (int y = start; y < height - start; ++y) {
+                    filterKernels->clampRow(&current[static_cast<size_t>(width) * y + start], count, stage.a,
+                                            stage.b);
+                }
+                break;
+        }
+        margin = start;
+        restoreEdges(margin);
+    }
+
+    for (int y = y0; y < y1; ++y) {
+        const float *row = &current[static_cast<size_t>(width) * (y - top) + halo];
+        if (result.getLayout() == HeightLayout::RowMajor) {
+            std::copy(row, row + (x1 - x0), result.row(y) + x0);
+            continue;
+        }
+        for (int x = x0; x < x1; ++x) {
+            result.at(x, y) = row[x - x0];
+        }
+    }
+}
+
+void FilterChain::apply(HeightField &field, int, int) const {
+    int size = static_cast<int>(field.getSize());
+    if (stages.empty() || size < 3) {
+        return;
+    }
+
+    HeightField result(field.getSize(), field.getLayout());
+    int tiles = (size + FILTER_TILE_SIZE - 1) / FILTER_TILE_SIZE;
+    ThreadPool::global().parallelFor(0, tiles * tiles, [&](int tile) {
+        filterTile(field, result, tile % tiles, tile / tiles);
+    });
+    field = std::move(result);
+}
@@ -0,0 +1,94 @@
+
+#ifndef PROCGEN_HEIGHTFILTERS_H
+#define PROCGEN_HEIGHTFILTERS_H
+
+
+#include <vector>
+#include "FilterKernels.h"
+#include "HeightPipeline.h"
+
+// Samples along each side of the tiles the chain runs over, before the halo
+#define FILTER_TILE_SIZE 64
+
+/**
+ * A chain of grid filters run over the heights as one pass: thermal erosion, blurring, terracing and clamping, in the
+ * order they're added.
+ *
+ * Rather than each filter going over the whole field, the field is cut into tiles and every filter runs over one tile
+ * before moving on to the next, so the heights stay in cache between filters and the field is only read and written
+ * once however long the chain is. Filters that look at their neighbours need a halo around the tile, which is worked
+ * out again by each tile that overlaps it. Tiles only read the original heights, so they run in parallel, and the
+ * result is exactly the same as running the filters one after the other over the whole field.
+ *
+ * The outermost samples never change, which keeps chunks filtered separately meeting their neighbours
+ */
+class FilterChain : public HeightFieldPass {
+private:
+    enum class StageType {
+        Thermal,
+        Blur,
+        Terrace,
+        Clamp
+    };
+
+    struct Stage {
+        StageType type;
+        int radius; // Samples read either side, 0 for filters that only look at the sample itself
+        float a, b; // Talus and rate, step height and ramp, or min and max
+        std::vector<float> weights;
+    };
+
+    std::vector<Stage> stages;
+    int halo = 0;
+    const filter::FilterKernels *filterKernels;
+
+    /**
+     * Runs every stage over one tile and writes it to result
+     */
+    void filterTile(const HeightField &field, HeightField &result, int tileX, int tileY) const;
+
+public:
+    FilterChain();
+
+    /**
+     * Thermal erosion: slopes steeper than the talus slump until they aren't, piling scree at their feet
+     * @param iterations Each one moves material at most one sample
+     * @param talus Steepest height difference between neighbours that stays put
+     * @param rate Fraction of the excess moved each iteration, up to .25
+     */
+    void addThermal(int iterations, float talus, float rate = .25f);
+
+    /**
+     * Separable Gaussian blur
+     * @param sigma Standard deviation in samples, the blur reaches three times this
+     */
+    void addBlur(float sigma);
+
+    /**
+     * Flattens heights into steps, see expr::Terrace
+     */
+    void addTerrace(float stepHeight, float ramp);
+
+    /**
+     * Clamps heights, e.g. a minimum just under the water level flattens the sea bed and stops anything poking
+     * through the water
+     */
+    void addClamp(float min, float max);
+
+    void apply(HeightField &field, int originX, int originY) const override;
+
+    void hash(Hasher &hasher) const override;
+
+    /**
+     * Samples each tile reads past its edges
+     */
+    int getHalo() const;
+
+    /**
+     * Overrides the filter kernels picked for this CPU, e.g. to compare against the scalar reference
+     */
+    void setKernels(const filter::FilterKernels &filterKernels);
+};
+
+
+#endif //PROCGEN_HEIGHTFILTERS_H
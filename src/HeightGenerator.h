@@ -0,0 +1,73 @@
+
+#ifndef PROCGEN_HEIGHTGENERATOR_H
+#define PROCGEN_HEIGHTGENERATOR_H
+
+
+#include <algorithm>
+#include <vector>
+#include "Hash.h"
+#include "HeightField.h"
+#include "ThreadPool.h"
+
+// Rows filled by each task in generateRows
+#define GENERATE_BLOCK_ROWS 16
+
+/**
+ * Something that fills height fields. Generators don't change while generating, so one generator can be shared by
+ * every thread generating chunks
+ */
+class HeightGenerator {
+public:
+    virtual ~HeightGenerator() = default;
+
+    /**
+     * Fills the height field, replacing anything already in it
+     * @param originX Where the field's first sample sits in the world, in samples. Fields generated at neighbouring
+     *                origins line up along their shared edge
+     * @param originY See originX
+     */
+    virtual void generate(HeightField &field, int originX = 0, int originY = 0) const = 0;
+
+    /**
+     * @return Rough height either side of zero the terrain reaches. Used to texture separately generated fields
+     *         against the same range
+     */
+    virtual float getHeightScale() const = 0;
+
+    /**
+     * Adds everything that changes the heights generate makes to the hasher, so they can be cached by it. Things that
+     * don't, like which SIMD kernels get used, are left out
+     */
+    virtual void hash(Hasher &hasher) const = 0;
+
+protected:
+    /**
+     * Fills a field a row at a time across the thread pool, for generators whose rows don't depend on each other.
+     * Rows are split up with no barriers in between
+     * @param generateRow Called as generateRow(x, y, count, out) to fill out with the heights at (x + i, y), in world
+     *                    samples
+     */
+    template<typename F>
+    static void generateRows(HeightField &field, int originX, int originY, const F &generateRow) {
+        int size = field.getSize();
+        bool rowMajor = field.getLayout() == HeightLayout::RowMajor;
+        int blocks = (size + GENERATE_BLOCK_ROWS - 1) / GENERATE_BLOCK_ROWS;
+        ThreadPool::global().parallelFor(0, blocks, [&](int block) {
+            int yEnd = std::min(size, (block + 1) * GENERATE_BLOCK_ROWS);
+            std::vector<float> row(rowMajor ? 0 : size);
+            for (int y = block * GENERATE_BLOCK_ROWS; y < yEnd; ++y) {
+                if (rowMajor) {
+                    generateRow(originX, originY + y, size, field.row(y));
+                    continue;
+                }
+                generateRow(originX, originY + y, size, row.data());
+                for (int x = 0; x < size; ++x) {
+                    field.at(x, y) = row[x];
+                }
+            }
+        });
+    }
+};
+
+
+#endif //PROCGEN_HEIGHTGENERATOR_H
@@ -0,0 +1,27 @@
+
+#include "HeightPipeline.h"
+
+HeightPipeline::HeightPipeline(std::shared_ptr<const HeightGenerator> generator) : generator(std::move(generator)) {}
+
+void HeightPipeline::addPass(std::shared_ptr<const HeightFieldPass> pass) {
+    passes.push_back(std::move(pass));
+}
+
+void HeightPipeline::generate(HeightField &field, int originX, int originY) const {
+    generator->generate(field, originX, originY);
+    for (const auto &pass : passes) {
+        pass->apply(field, originX, originY);
+    }
+}
+
+float HeightPipeline::getHeightScale() const {
+    return generator->getHeightScale();
+}
+
+void HeightPipeline::hash(Hasher &hasher) const {
+    generator->hash(hasher);
+    hasher.add(passes.size());
+    for (const auto &pass : passes) {
+        pass->hash(hasher);
+    }
+}
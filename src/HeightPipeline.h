@@ -0,0 +1,55 @@
+
+#ifndef PROCGEN_HEIGHTPIPELINE_H
+#define PROCGEN_HEIGHTPIPELINE_H
+
+
+#include <memory>
+#include <vector>
+#include "HeightGenerator.h"
+
+/**
+ * A step run over heights after they've been generated, such as erosion. Like generators, passes don't change while
+ * running so one pass can be shared between threads
+ */
+class HeightFieldPass {
+public:
+    virtual ~HeightFieldPass() = default;
+
+    /**
+     * @param originX Where the field's first sample sits in the world, so randomness can be keyed by world position
+     * @param originY See originX
+     */
+    virtual void apply(HeightField &field, int originX, int originY) const = 0;
+
+    /**
+     * Adds everything that changes what apply does to the hasher, see HeightGenerator::hash
+     */
+    virtual void hash(Hasher &hasher) const = 0;
+};
+
+/**
+ * A generator followed by passes over its output. It's a generator itself, so it goes anywhere one does and the passes
+ * run before the mesh is built
+ */
+class HeightPipeline : public HeightGenerator {
+private:
+    std::shared_ptr<const HeightGenerator> generator;
+    std::vector<std::shared_ptr<const HeightFieldPass>> passes;
+
+public:
+    explicit HeightPipeline(std::shared_ptr<const HeightGenerator> generator);
+
+    /**
+     * Adds a pass to run after the ones already added
+     */
+    void addPass(std::shared_ptr<const HeightFieldPass> pass);
+
+    void generate(HeightField &field, int originX = 0, int originY = 0) const override;
+
+    float getHeightScale() const override;
+
+    void hash(Hasher &hasher) const override;
+};
+
+
+#endif //PROCGEN_HEIGHTPIPELINE_H
@@ -0,0 +1,215 @@
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "HydraulicErosion.h"
+#include "Random.h"
+#include "ThreadPool.h"
+
+HydraulicErosion::HydraulicErosion(unsigned int seed, const ErosionSettings &settings)
+        : seed(seed), settings(settings) {
+    if (settings.radius < 1) {
+        std::cerr << "Erosion radius must be at least 1, got " << settings.radius << std::endl;
+        HydraulicErosion::settings.radius = 1;
+    }
+    int radius = HydraulicErosion::settings.radius;
+
+    // Weights fall off linearly from the centre and add up to 1
+    float total = 0.f;
+    for (int y = -radius; y <= radius; ++y) {
+        for (int x = -radius; x <= radius; ++x) {
+            float weight = static_cast<float>(radius) - std::sqrt(static_cast<float>(x * x + y * y));
+            if (weight > 0.f) {
+                brush.push_back({x, y, weight});
+                total += weight;
+            }
+        }
+    }
+    for (auto &point : brush) {
+        point.weight /= total;
+    }
+
+    // A droplet moves one sample a step and touches the brush, plus one for the bilinear corners and one for rounding
+    int reach = std::max(HydraulicErosion::settings.lifetime, 0) + radius + 2;
+    tileSize = std::max(reach * 2, 32);
+}
+
+long long HydraulicErosion::getDropletCount(unsigned int size) const {
+    int tiles = (static_cast<int>(size) - 2) / tileSize + 1;
+    long long count = 0;
+    for (int tileY = 0; tileY < tiles; ++tileY) {
+        for (int tileX = 0; tileX < tiles; ++tileX) {
+            count += getTileDroplets(static_cast<int>(size), tileX, tileY);
+        }
+    }
+    return count;
+}
+
+int HydraulicErosion::getTileSize() const {
+    return tileSize;
+}
+
+void HydraulicErosion::hash(Hasher &hasher) const {
+    hasher.add("HydraulicErosion").add(seed).add(settings.dropletsPerSample).add(settings.lifetime)
+            .add(settings.radius).add(settings.inertia).add(settings.capacity).add(settings.minCapacity)
+            .add(settings.erodeSpeed).add(settings.depositSpeed).add(settings.evaporateSpeed).add(settings.gravity);
+}
+
+int HydraulicErosion::getTileDroplets(int size, int tileX, int tileY) const {
+    // Droplets start anywhere in the cells between samples, of which there are size - 1 along each side
+    int width = std::min(tileSize, size - 1 - tileX * tileSize);
+    int height = std::min(tileSize, size - 1 - tileY * tileSize);
+    return static_cast<int>(std::lround(static_cast<float>(width * height) * settings.dropletsPerSample));
+}
+
+void HydraulicErosion::simulateDroplet(float *heights, int size, const std::ptrdiff_t *brushOffsets, float x,
+                                       float y) const {
+    float dirX = 0.f, dirY = 0.f;
+    float speed = 1.f;
+    float water = 1.f;
+    float sediment = 0.f;
+
+    for (int step = 0; step < settings.lifetime; ++step) {
+        int cellX = static_cast<int>(x);
+        int cellY = static_cast<int>(y);
+        float u = x - static_cast<float>(cellX);
+        float v = y - static_cast<float>(cellY);
+        size_t cell = static_cast<size_t>(size) * cellY + cellX;
+
+        // Height and slope under the droplet, bilinearly from the corners of its cell
+        float h00 = heights[cell], h10 = heights[cell + 1];
+        float h01 = heights[cell + size], h11 = heights[cell + size + 1];
+        float gradientX = (h10 - h00) * (1.f - v) + (h11 - h01) * v;
+        float gradientY = (h01 - h00) * (1.f - u) + (h11 - h10) * u;
+        float height = h00 * (1.f - u) * (1.f - v) + h10 * u * (1.f - v) + h01 * (1.f - u) * v + h11 * u * v;
+
+        dirX = dirX * settings.inertia - gradientX * (1.f - settings.inertia);
+        dirY = dirY * settings.inertia - gradientY * (1.f - settings.inertia);
+        float length = std::sqrt(dirX * dirX + dirY * dirY);
+        if (length < 1e-6f) {
+            // Came to rest in a pit or on perfectly flat ground
+            break;
+        }
+        dirX /= length;
+        dirY /= length;
+        x += dirX;
+        y += dirY;
+        if (x < 0.f || y < 0.f || x >= static_cast<float>(size - 1) || y >= static_cast<float>(size - 1)) {
+            // Ran off the edge, the sediment goes with it
+            break;
+        }
+
+        int nextX = static_cast<int>(x);
+        int nextY = static_cast<int>(y);
+        float nextU = x - static_cast<float>(nextX);
+        float nextV = y - static_cast<float>(nextY);
+        size_t next = static_cast<size_t>(size) * nextY + nextX;
+        float newHeight = heights[next] * (1.f - nextU) * (1.f - nextV) + heights[next + 1] * nextU * (1.f - nextV) +
+                          heights[next + size] * (1.f - nextU) * nextV + heights[next + size + 1] * nextU * nextV;
+        float drop = newHeight - height;
+
+        float capacity = std::max(-drop * speed * water * settings.capacity, settings.minCapacity);
+        if (sediment > capacity || drop > 0.f) {
+            // Going uphill fills the hole behind it, otherwise it drops what it can no longer carry
+            float amount = drop > 0.f ? std::min(drop, sediment) : (sediment - capacity) * settings.depositSpeed;
+            sediment -= amount;
+            float weights[4] = {(1.f - u) * (1.f - v), u * (1.f - v), (1.f - u) * v, u * v};
+            int corners[4][2] = {{cellX, cellY}, {cellX + 1, cellY}, {cellX, cellY + 1}, {cellX + 1, cellY + 1}};
+            for (int i = 0; i < 4; ++i) {
+                int cornerX = corners[i][0], cornerY = corners[i][1];
+                if (cornerX > 0 && cornerY > 0 && cornerX < size - 1 && cornerY < size - 1) {
+                    heights[static_cast<size_t>(size) * cornerY + cornerX] += amount * weights[i];
+                }
+            }
+        } else {
+            // Never digs deeper than the drop, that would leave a pit behind
+            float amount = std::min((capacity - sediment) * settings.erodeSpeed, -drop);
+            int radius = settings.radius;
+            if (cellX > radius && cellY > radius && cellX < size - 1 - radius && cellY < size - 1 - radius) {
+                // Clear of the edges, so the whole brush lands and the weights add up to the full amount
+                for (size_t i = 0; i < brush.size(); ++i) {
+                    heights[cell + brushOffsets[i]] -= amount * brush[i].weight;
+                }
+                sediment += amount;
+            } else for (const auto &point : brush) {
+                int brushX = cellX + point.x, brushY = cellY + point.y;
+                if (brushX > 0 && brushY > 0 && brushX < size - 1 && brushY < size - 1) {
+                    float eroded = amount * point.weight;
+                    heights[static_cast<size_t>(size) * brushY + brushX] -= eroded;
+                    sediment += eroded;
+                }
+            }
+        }
+
+        speed = std::sqrt(std::max(speed * speed - drop * settings.gravity, 0.f));
+        water *= 1.f - settings.evaporateSpeed;
+    }
+}
+
+void HydraulicErosion::erodeTile(float *heights, int size, const std::ptrdiff_t *brushOffsets, int tileX, int tileY,
+                                 int droplets, uint64_t tileSeed) const {
+    Random random(tileSeed);
+    float x0 = static_cast<float>(tileX * tileSize);
+    float y0 = static_cast<float>(tileY * tileSize);
+    float x1 = std::min(x0 + static_cast<float>(tileSize), static_cast<float>(size - 1));
+    float y1 = std::min(y0 + static_cast<float>(tileSize), static_cast<float>(size - 1));
+    // Rounding can land uniform() exactly on the upper bound. On the last column or row the droplet's first step would
+    // then read the cells past it, so keep starts strictly below
+    float xMax = std::nextafter(x1, x0);
+    float yMax = std::nextafter(y1, y0);
+    for (int droplet = 0; droplet < droplets; ++droplet) {
+        float x = std::min(random.uniform(0, droplet, x0, x1), xMax);
+        float y = std::min(random.uniform(1, droplet, y0, y1), yMax);
+        simulateDroplet(heights, size, brushOffsets, x, y);
+    }
+}
+
+void HydraulicErosion::apply(HeightField &field, int originX, int originY) const {
+    int size = static_cast<int>(field.getSize());
+    if (size < 3) {
+        return;
+    }
+
+    // Droplets hop around a lot, so tiled fields are eroded in a row major copy
+    bool rowMajor = field.getLayout() == HeightLayout::RowMajor;
+    std::vector<float> copy;
+    float *heights = field.getData();
+    if (!rowMajor) {
+        copy.resize(static_cast<size_t>(size) * size);
+        field.forEach([&](int x, int y, float height) {
+            copy[static_cast<size_t>(size) * y + x] = height;
+        });
+        heights = copy.data();
+    }
+
+    std::vector<std::ptrdiff_t> brushOffsets;
+    for (const auto &point : brush) {
+        brushOffsets.push_back(static_cast<std::ptrdiff_t>(size) * point.y + point.x);
+    }
+
+    Random random(seed);
+    int tiles = (size - 2) / tileSize + 1;
+    for (int round = 0; round < EROSION_ROUNDS; ++round) {
+        for (int colour = 0; colour < 4; ++colour) {
+            int offsetX = colour & 1, offsetY = colour >> 1;
+            int columns = (tiles - offsetX + 1) / 2;
+            int rows = (tiles - offsetY + 1) / 2;
+            ThreadPool::global().parallelFor(0, columns * rows, [&](int i) {
+                int tileX = offsetX + i % columns * 2;
+                int tileY = offsetY + i / columns * 2;
+                int total = getTileDroplets(size, tileX, tileY);
+                int droplets = total * (round + 1) / EROSION_ROUNDS - total * round / EROSION_ROUNDS;
+                // Keyed by where the tile is in the world, so moving the origin doesn't just repeat the same droplets
+                uint64_t tileSeed = random.next(round, Random::counter(originX + tileX * tileSize,
+                                                                       originY + tileY * tileSize));
+                erodeTile(heights, size, brushOffsets.data(), tileX, tileY, droplets, tileSeed);
+            });
+        }
+    }
+
+    if (!rowMajor) {
+        field.forEach([&](int x, int y, float &height) {
+            height = copy[static_cast<size_t>(size) * y + x];
+        });
+    }
+}
@@ -0,0 +1,91 @@
+
+#ifndef PROCGEN_HYDRAULICEROSION_H
+#define PROCGEN_HYDRAULICEROSION_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "HeightPipeline.h"
+
+// Droplets per second a single thread should manage on a 1025 map with the default settings, checked by
+// ProcGenErosionBench
+#define EROSION_TARGET_DROPLETS_PER_SECOND 400000
+// Each tile's droplets are split over this many runs through the colours, so no colour always goes first
+#define EROSION_ROUNDS 4
+
+struct ErosionSettings {
+    float dropletsPerSample = 1.f; // Droplets simulated for every sample in the field
+    int lifetime = 30; // Steps before a droplet gives up, each step moves one sample
+    int radius = 3; // Radius of the brush droplets wear the ground away with
+    float inertia = .05f; // How much of its direction a droplet keeps rather than following the slope
+    float capacity = 4.f; // Sediment carried per unit of speed, water and drop
+    float minCapacity = .01f; // Lets droplets keep eroding on flat ground
+    float erodeSpeed = .3f; // Fraction of the spare capacity picked up each step
+    float depositSpeed = .3f; // Fraction of the excess sediment dropped each step
+    float evaporateSpeed = .01f; // Fraction of the water lost each step
+    float gravity = 4.f;
+};
+
+/**
+ * Particle based hydraulic erosion. Droplets are dropped at random, run downhill picking up sediment where they
+ * speed up and dropping it where they slow down, which carves gullies and fills valleys with smooth deposits.
+ *
+ * The field is split into square tiles coloured like a 2x2 checkerboard. A droplet only ever starts in its own tile,
+ * and tiles are at least twice as big as the distance a droplet can reach, so tiles of one colour never touch the same
+ * samples and run in parallel with no locks or atomics. The colours run one after the other, and every droplet's
+ * start comes from the counter based generator keyed by its tile and number, so the result only depends on the seed
+ * and never on the number of threads.
+ *
+ * The outermost samples are never changed, which keeps chunks eroded separately meeting their neighbours
+ */
+class HydraulicErosion : public HeightFieldPass {
+private:
+    struct BrushPoint {
+        int x, y;
+        float weight;
+    };
+
+    unsigned int seed;
+    ErosionSettings settings;
+    std::vector<BrushPoint> brush;
+    int tileSize;
+
+    /**
+     * Runs one droplet from (x, y) on a row major field
+     * @param brushOffsets Offset of each brush point from the centre in the field's storage
+     */
+    void simulateDroplet(float *heights, int size, const std::ptrdiff_t *brushOffsets, float x, float y) const;
+
+    /**
+     * Runs every droplet that starts in one tile
+     * @param tileSeed Seeds the droplet starts, unique to the tile and round
+     */
+    void erodeTile(float *heights, int size, const std::ptrdiff_t *brushOffsets, int tileX, int tileY, int droplets,
+                   uint64_t tileSeed) const;
+
+    /**
+     * @return Droplets that start in one tile, over all rounds
+     */
+    int getTileDroplets(int size, int tileX, int tileY) const;
+
+public:
+    HydraulicErosion(unsigned int seed, const ErosionSettings &settings = ErosionSettings());
+
+    void apply(HeightField &field, int originX, int originY) const override;
+
+    void hash(Hasher &hasher) const override;
+
+    /**
+     * @return Number of droplets apply simulates for a field of the given size
+     */
+    long long getDropletCount(unsigned int size) const;
+
+    /**
+     * Side length of the tiles droplets are split up by
+     */
+    int getTileSize() const;
+};
+
+
+#endif //PROCGEN_HYDRAULICEROSION_H
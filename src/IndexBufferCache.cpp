@@ -0,0 +1,136 @@
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include "IndexBufferCache.h"
+
+void SharedIndexBuffer::draw() const {
+    if (drawCounts.size() == 1) {
+        glDrawElements(mode, drawCounts[0], indexType, drawOffsets[0]);
+    } else {
+        glMultiDrawElementsBaseVertex(mode, drawCounts.data(), indexType, drawOffsets.data(),
+                                      static_cast<GLsizei>(drawCounts.size()), drawBaseVertices.data());
+    }
+}
+
+IndexBufferCache::~IndexBufferCache() {
+    // The global cache outlives the GL context, so only clear() deletes the buffers themselves
+    for (auto &buffer : buffers) {
+        delete buffer.second;
+    }
+}
+
+void IndexBufferCache::clear() {
+    for (auto &buffer : buffers) {
+        glDeleteBuffers(1, &buffer.second->ibo);
+        delete buffer.second;
+    }
+    buffers.clear();
+}
+
+SharedIndexBuffer *IndexBufferCache::build(const IndexBufferKey &key) {
+    auto buffer = new SharedIndexBuffer;
+    buffer->mode = key.order == IndexOrder::RowStrips ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+    buffer->references = 0;
+
+    unsigned int size = key.size;
+    unsigned int quadRows = size - 1u;
+    glGenBuffers(1, &buffer->ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer->ibo);
+
+    if (key.mode == IndexMode::Wide) {
+        size_t indexCount = key.order == IndexOrder::RowStrips ? indexBuilder::stripIndexCount(size, quadRows)
+                                                               : static_cast<size_t>(quadRows) * quadRows * 6;
+        if (!indexBuilder::canIndex<unsigned int>(size, quadRows) ||
+            indexCount > static_cast<size_t>(std::numeric_limits<GLsizei>::max())) {
+            std::cerr << "A " << size << "x" << size << " grid has too many vertices or indices to draw" << std::endl;
+            buffer->indexType = GL_UNSIGNED_INT;
+            buffer->drawCounts.push_back(0);
+            buffer->drawBaseVertices.push_back(0);
+            buffer->drawOffsets.push_back(nullptr);
+            return buffer;
+        }
+        auto indices = indexBuilder::buildGrid<unsigned int>(size, quadRows, key.order);
+        buffer->indexType = GL_UNSIGNED_INT;
+        buffer->drawCounts.push_back(static_cast<GLsizei>(indices.size()));
+        buffer->drawBaseVertices.push_back(0);
+        buffer->drawOffsets.push_back(nullptr);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        return buffer;
+    }
+
+    // Every meshlet is the same grid shifted down by its base vertex, so they all share one index buffer. With strips
+    // the last meshlet can have fewer rows and just draws a prefix. Small grids are a single meshlet
+    unsigned int meshletRows = std::min(indexBuilder::meshletQuadRows(size), quadRows);
+    auto indices = indexBuilder::buildGrid<unsigned short>(size, meshletRows, key.order);
+    auto meshletCount = static_cast<GLsizei>(indices.size());
+    buffer->indexType = GL_UNSIGNED_SHORT;
+
+    // Triangle lists aren't in row order, so a shorter last meshlet gets its own indices after the shared ones
+    unsigned int lastRows = quadRows % meshletRows;
+    size_t lastOffset = indices.size();
+    if (lastRows != 0 && key.order != IndexOrder::RowStrips) {
+        auto lastIndices = indexBuilder::buildGrid<unsigned short>(size, lastRows, key.order);
+        indices.insert(indices.end(), lastIndices.begin(), lastIndices.end());
+    }
+
+    for (unsigned int row = 0; row < quadRows; row += meshletRows) {
+        unsigned int rows = std::min(meshletRows, quadRows - row);
+        buffer->drawBaseVertices.push_back(static_cast<GLint>(row * size));
+        if (rows == meshletRows) {
+            buffer->drawCounts.push_back(meshletCount);
+            buffer->drawOffsets.push_back(nullptr);
+        } else if (key.order == IndexOrder::RowStrips) {
+            buffer->drawCounts.push_back(static_cast<GLsizei>(indexBuilder::stripIndexCount(size, rows)));
+            buffer->drawOffsets.push_back(nullptr);
+        } else {
+            buffer->drawCounts.push_back(static_cast<GLsizei>(indices.size() - lastOffset));
+            buffer->drawOffsets.push_back(reinterpret_cast<const void *>(lastOffset * sizeof(unsigned short)));
+        }
+    }
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+    return buffer;
+}
+
+const SharedIndexBuffer *IndexBufferCache::acquire(const IndexBufferKey &requested) {
+    // Not even one row of quads fits in 16 bit indices on grids this wide
+    IndexBufferKey key = requested;
+    if (key.mode == IndexMode::Meshlets && !indexBuilder::fitsMeshlets(key.size)) {
+        key.mode = IndexMode::Wide;
+    }
+
+    auto &buffer = buffers[key];
+    if (buffer == nullptr) {
+        buffer = build(key);
+        ++uploads;
+    }
+    ++buffer->references;
+    return buffer;
+}
+
+void IndexBufferCache::release(const SharedIndexBuffer *buffer) {
+    for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+        if (it->second != buffer) {
+            continue;
+        }
+        if (--it->second->references == 0) {
+            glDeleteBuffers(1, &it->second->ibo);
+            delete it->second;
+            buffers.erase(it);
+        }
+        return;
+    }
+}
+
+size_t IndexBufferCache::getBufferCount() const {
+    return buffers.size();
+}
+
+size_t IndexBufferCache::getUploadCount() const {
+    return uploads;
+}
+
+IndexBufferCache &IndexBufferCache::global() {
+    static IndexBufferCache cache;
+    return cache;
+}
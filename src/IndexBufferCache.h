@@ -0,0 +1,91 @@
+
+#ifndef PROCGEN_INDEXBUFFERCACHE_H
+#define PROCGEN_INDEXBUFFERCACHE_H
+
+
+#include <glad/glad.h>
+#include <unordered_map>
+#include <vector>
+#include "IndexBuilder.h"
+
+struct IndexBufferKey {
+    unsigned int size; // Vertices along each side of the grid
+    IndexMode mode;
+    IndexOrder order;
+
+    bool operator==(const IndexBufferKey &other) const {
+        return size == other.size && mode == other.mode && order == other.order;
+    }
+};
+
+struct IndexBufferKeyHash {
+    size_t operator()(const IndexBufferKey &key) const {
+        return std::hash<unsigned int>()(key.size * 16 + static_cast<unsigned int>(key.mode) * 4 +
+                                         static_cast<unsigned int>(key.order));
+    }
+};
+
+/**
+ * An index buffer for a grid, along with what's needed to draw it
+ */
+struct SharedIndexBuffer {
+    GLuint ibo;
+    GLenum mode;
+    GLenum indexType;
+    // One entry per meshlet, or a single entry covering the whole grid
+    std::vector<GLsizei> drawCounts;
+    std::vector<GLint> drawBaseVertices;
+    std::vector<const void *> drawOffsets;
+    int references;
+
+    /**
+     * Draws the whole grid. The buffer must already be bound to the current vertex array
+     */
+    void draw() const;
+};
+
+/**
+ * Every same sized terrain draws with the same indices, so they share one index buffer from here rather than each
+ * uploading their own. Buffers are reference counted and deleted once nothing uses them.
+ * OpenGL objects can only be used from the thread that owns the context, so this isn't thread safe
+ */
+class IndexBufferCache {
+private:
+    std::unordered_map<IndexBufferKey, SharedIndexBuffer *, IndexBufferKeyHash> buffers;
+    size_t uploads = 0;
+
+    static SharedIndexBuffer *build(const IndexBufferKey &key);
+
+public:
+    ~IndexBufferCache();
+
+    /**
+     * Gets the buffer for a grid, building and uploading it if nothing is using one yet. Grids too wide for meshlets
+     * get 32 bit indices instead.
+     * Every acquire must be matched by a release
+     */
+    const SharedIndexBuffer *acquire(const IndexBufferKey &requested);
+
+    void release(const SharedIndexBuffer *buffer);
+
+    /**
+     * Deletes every buffer, whether or not it's still used. Call while the GL context is still current, the destructor
+     * runs too late to
+     */
+    void clear();
+
+    /**
+     * @return Number of index buffers currently alive
+     */
+    size_t getBufferCount() const;
+
+    /**
+     * @return Number of index buffers uploaded since the start
+     */
+    size_t getUploadCount() const;
+
+    static IndexBufferCache &global();
+};
+
+
+#endif //PROCGEN_INDEXBUFFERCACHE_H
@@ -0,0 +1,169 @@
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include "IndexBuilder.h"
+
+namespace {
+    // Scoring constants from the paper
+    const float cacheDecayPower = 1.5f;
+    const float lastTriangleScore = .75f;
+    const float valenceBoostScale = 2.f;
+    const float valenceBoostPower = .5f;
+
+    float vertexScore(int cachePosition, unsigned int remainingTriangles) {
+        if (remainingTriangles == 0) {
+            // Nothing left to draw with this vertex
+            return -1.f;
+        }
+
+        float score = 0.f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                // Used by the last triangle. Fixed score so there's no bias towards one of its edges
+                score = lastTriangleScore;
+            } else {
+                float scaler = 1.f / (VERTEX_CACHE_SIZE - 3);
+                score = std::pow(1.f - static_cast<float>(cachePosition - 3) * scaler, cacheDecayPower);
+            }
+        }
+
+        // Vertices with few triangles left get a boost, so lone triangles aren't left until the end
+        return score + valenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -valenceBoostPower);
+    }
+}
+
+void indexBuilder::optimiseVertexCache(std::vector<unsigned int> &indices, size_t vertexCount) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Triangles using each vertex, the first remaining[v] entries are the ones not drawn yet
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (auto index : indices) {
+        ++remaining[index];
+    }
+    std::vector<size_t> firstTriangle(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+    }
+    std::vector<unsigned int> vertexTriangles(indices.size());
+    std::vector<size_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        vertexTriangles[filled[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        vertexScores[v] = vertexScore(-1, remaining[v]);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> added(triangleCount, false);
+    size_t best = 0;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] +
+                            vertexScores[indices[t * 3 + 2]];
+        if (triangleScores[t] > triangleScores[best]) {
+            best = t;
+        }
+    }
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    std::vector<unsigned int> cache, nextCache;
+    size_t nextUnadded = 0;
+
+    for (size_t drawn = 0; drawn < triangleCount; ++drawn) {
+        if (best == triangleCount) {
+            // Nothing in the cache has triangles left, carry on from the first triangle not drawn yet
+            while (added[nextUnadded]) {
+                ++nextUnadded;
+            }
+            best = nextUnadded;
+        }
+
+        added[best] = true;
+        nextCache.clear();
+        for (int corner = 0; corner < 3; ++corner) {
+            unsigned int v = indices[best * 3 + corner];
+            output.push_back(v);
+            nextCache.push_back(v);
+
+            // Take the triangle out of the vertex's remaining list
+            auto begin = vertexTriangles.begin() + firstTriangle[v];
+            auto end = begin + remaining[v];
+            std::iter_swap(std::find(begin, end, best), end - 1);
+            --remaining[v];
+        }
+
+        // The triangle's vertices go to the front of the cache, everything else gets pushed back
+        for (auto v : cache) {
+            if (v != nextCache[0] && v != nextCache[1] && v != nextCache[2]) {
+                nextCache.push_back(v);
+            }
+        }
+        for (size_t i = 0; i < nextCache.size(); ++i) {
+            unsigned int v = nextCache[i];
+            cachePosition[v] = i < VERTEX_CACHE_SIZE ? static_cast<int>(i) : -1;
+            vertexScores[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+
+        // Rescore the triangles that touch the cache and pick the best for next time
+        best = triangleCount;
+        float bestScore = -1.f;
+        for (auto v : nextCache) {
+            auto begin = vertexTriangles.begin() + firstTriangle[v];
+            for (auto it = begin; it != begin + remaining[v]; ++it) {
+                unsigned int t = *it;
+                triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] +
+                                    vertexScores[indices[t * 3 + 2]];
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+
+        if (nextCache.size() > VERTEX_CACHE_SIZE) {
+            nextCache.resize(VERTEX_CACHE_SIZE);
+        }
+        cache.swap(nextCache);
+    }
+
+    indices.swap(output);
+}
+
+VertexCacheStats indexBuilder::measureVertexCache(const std::vector<unsigned int> &indices, bool strip,
+                                                  size_t vertexCount, unsigned int cacheSize) {
+    std::vector<bool> cached(vertexCount, false);
+    std::deque<unsigned int> fifo;
+    size_t transforms = 0;
+    for (auto index : indices) {
+        if (cached[index]) {
+            continue;
+        }
+        ++transforms;
+        cached[index] = true;
+        fifo.push_back(index);
+        if (fifo.size() > cacheSize) {
+            cached[fifo.front()] = false;
+            fifo.pop_front();
+        }
+    }
+
+    size_t triangles = 0;
+    if (strip) {
+        for (size_t i = 2; i < indices.size(); ++i) {
+            if (indices[i] != indices[i - 1] && indices[i] != indices[i - 2] && indices[i - 1] != indices[i - 2]) {
+                ++triangles;
+            }
+        }
+    } else {
+        triangles = indices.size() / 3;
+    }
+
+    return {static_cast<double>(transforms) / static_cast<double>(triangles),
+            static_cast<double>(transforms) / static_cast<double>(vertexCount)};
+}
@@ -0,0 +1,205 @@
+
+#ifndef PROCGEN_INDEXBUILDER_H
+#define PROCGEN_INDEXBUILDER_H
+
+
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// Largest number of vertices a 16 bit index can address
+#define MAX_SHORT_INDEXED_VERTICES 65536
+// Post-transform vertex cache size the cache optimised orders aim for
+#define VERTEX_CACHE_SIZE 32
+// Quads across each band of the column band order. The previous row of the band has to still be in the cache
+#define COLUMN_BAND_WIDTH (VERTEX_CACHE_SIZE / 2 - 2)
+
+enum class IndexOrder {
+    RowStrips, // One triangle strip, row after row with degenerate joins
+    ColumnBands, // Triangle list going row by row down narrow bands of columns
+    Forsyth // Triangle list reordered with Forsyth's linear-speed vertex cache optimisation
+};
+
+enum class IndexMode {
+    // 16 bit indices. Terrains over 64K vertices are split into bands of rows that share one index buffer, each drawn
+    // with its own base vertex in a single multi draw call. Grids over 32K vertices across fall back to Wide
+    Meshlets,
+    Wide // One strip over the whole terrain with 32 bit indices
+};
+
+struct VertexCacheStats {
+    double acmr; // Average cache miss ratio, vertex shader runs per triangle. 0.5 is the best possible on a grid
+    double atvr; // Average transform to vertex ratio, vertex shader runs per vertex. 1 is the best possible
+};
+
+namespace indexBuilder {
+    /**
+     * Number of indices in a triangle strip covering a grid, including the degenerate triangles joining the rows
+     * @param width Vertices per row
+     * @param quadRows Rows of quads, one less than the rows of vertices
+     */
+    inline size_t stripIndexCount(unsigned int width, unsigned int quadRows) {
+        return quadRows == 0 ? 0 : static_cast<size_t>(quadRows) * (2 * width + 2) - 2;
+    }
+
+    /**
+     * @return Whether every vertex of a grid can be addressed with indices of type T
+     * @param quadRows Rows of quads, one less than the rows of vertices
+     */
+    template<typename T>
+    bool canIndex(unsigned int width, unsigned int quadRows) {
+        return static_cast<size_t>(width) * (quadRows + 1) - 1 <= std::numeric_limits<T>::max();
+    }
+
+    /**
+     * Builds triangle strip indices for a grid of row major vertices, joining rows with degenerate triangles.
+     * The indices for the first n rows are a prefix of the indices for more rows, so one buffer can draw any number of
+     * rows up to quadRows
+     * @tparam T Index type, must be able to address width * (quadRows + 1) vertices
+     */
+    template<typename T>
+    std::vector<T> buildStrip(unsigned int width, unsigned int quadRows) {
+        assert(canIndex<T>(width, quadRows));
+        std::vector<T> indices;
+        indices.reserve(stripIndexCount(width, quadRows) + 2);
+        for (unsigned int y = 0; y < quadRows; ++y) {
+            // Worked out in size_t, unsigned int overflows on the widest grids 32 bit indices can still address
+            size_t rowStart = static_cast<size_t>(y) * width;
+            for (unsigned int x = 0; x < width; ++x) {
+                indices.push_back(static_cast<T>(rowStart + x));
+                indices.push_back(static_cast<T>(rowStart + x + width));
+            }
+            // Degenerate triangles
+            indices.push_back(static_cast<T>(rowStart + width + width - 1));
+            indices.push_back(static_cast<T>(rowStart + width));
+        }
+
+        // Remove last two which are degenerates
+        if (!indices.empty()) {
+            indices.pop_back();
+            indices.pop_back();
+        }
+        return indices;
+    }
+
+    /**
+     * Builds a triangle list for a square grid of row major vertices, one quadrant after another (top left, top right,
+     * bottom left, bottom right) so any quadrant can be drawn on its own. Quads are split the same way as the strips
+     * @param width Vertices along each side, must be odd
+     */
+    template<typename T>
+    std::vector<T> buildGridQuadrants(unsigned int width) {
+        assert(canIndex<T>(width, width - 1));
+        unsigned int half = (width - 1) / 2;
+        std::vector<T> indices;
+        indices.reserve(static_cast<size_t>(width - 1) * (width - 1) * 6);
+        for (unsigned int quadrant = 0; quadrant < 4; ++quadrant) {
+            unsigned int startX = (quadrant % 2) * half;
+            unsigned int startY = (quadrant / 2) * half;
+            for (unsigned int y = startY; y < startY + half; ++y) {
+                for (unsigned int x = startX; x < startX + half; ++x) {
+                    auto topLeft = static_cast<T>(static_cast<size_t>(y) * width + x);
+                    auto topRight = static_cast<T>(topLeft + 1);
+                    auto bottomLeft = static_cast<T>(topLeft + width);
+                    auto bottomRight = static_cast<T>(bottomLeft + 1);
+                    indices.insert(indices.end(), {topLeft, bottomLeft, topRight, topRight, bottomLeft, bottomRight});
+                }
+            }
+        }
+        return indices;
+    }
+
+    /**
+     * @return Whether a meshlet of at least one row of quads, two rows of vertices, fits in 16 bit indices. Wider grids
+     * need IndexMode::Wide
+     */
+    inline bool fitsMeshlets(unsigned int width) {
+        return width <= MAX_SHORT_INDEXED_VERTICES / 2;
+    }
+
+    /**
+     * @return Rows of quads in each meshlet, so that a meshlet's vertices can be addressed with 16 bit indices. Only
+     * meaningful where fitsMeshlets, 1 otherwise
+     */
+    inline unsigned int meshletQuadRows(unsigned int width) {
+        return fitsMeshlets(width) ? MAX_SHORT_INDEXED_VERTICES / width - 1 : 1;
+    }
+
+    /**
+     * Builds a triangle list for a grid of row major vertices, working down bands of columns one at a time
+     * @param bandWidth Quads across each band. A band as wide as the grid gives plain row order
+     */
+    template<typename T>
+    std::vector<T> buildColumnBands(unsigned int width, unsigned int quadRows, unsigned int bandWidth) {
+        assert(canIndex<T>(width, quadRows));
+        std::vector<T> indices;
+        indices.reserve(static_cast<size_t>(width - 1) * quadRows * 6);
+        for (unsigned int bandX = 0; bandX < width - 1; bandX += bandWidth) {
+            unsigned int bandEnd = bandX + bandWidth < width - 1 ? bandX + bandWidth : width - 1;
+            for (unsigned int y = 0; y < quadRows; ++y) {
+                for (unsigned int x = bandX; x < bandEnd; ++x) {
+                    auto topLeft = static_cast<T>(static_cast<size_t>(y) * width + x);
+                    auto topRight = static_cast<T>(topLeft + 1);
+                    auto bottomLeft = static_cast<T>(topLeft + width);
+                    auto bottomRight = static_cast<T>(bottomLeft + 1);
+                    indices.insert(indices.end(), {topLeft, bottomLeft, topRight, topRight, bottomLeft, bottomRight});
+                }
+            }
+        }
+        return indices;
+    }
+
+    /**
+     * Reorders a triangle list to reuse vertices while they are still in the post-transform cache, using Tom
+     * Forsyth's "Linear-Speed Vertex Cache Optimisation"
+     */
+    void optimiseVertexCache(std::vector<unsigned int> &indices, size_t vertexCount);
+
+    /**
+     * Builds a triangle list for a grid in a cache optimised order. Forsyth's reorder runs on bands of at most a
+     * meshlet's rows at a time, which keeps it fast on large grids
+     * @param order ColumnBands or Forsyth
+     */
+    template<typename T>
+    std::vector<T> buildTriangles(unsigned int width, unsigned int quadRows, IndexOrder order) {
+        if (order != IndexOrder::Forsyth) {
+            return buildColumnBands<T>(width, quadRows, COLUMN_BAND_WIDTH);
+        }
+
+        std::vector<T> indices;
+        indices.reserve(static_cast<size_t>(width - 1) * quadRows * 6);
+        unsigned int bandRows = meshletQuadRows(width);
+        for (unsigned int row = 0; row < quadRows; row += bandRows) {
+            unsigned int rows = bandRows < quadRows - row ? bandRows : quadRows - row;
+            auto band = buildColumnBands<unsigned int>(width, rows, width - 1);
+            optimiseVertexCache(band, static_cast<size_t>(width) * (rows + 1));
+            for (auto index : band) {
+                indices.push_back(static_cast<T>(index + static_cast<size_t>(row) * width));
+            }
+        }
+        return indices;
+    }
+
+    /**
+     * Builds the indices for a grid in any order, a strip for RowStrips and a triangle list otherwise
+     */
+    template<typename T>
+    std::vector<T> buildGrid(unsigned int width, unsigned int quadRows, IndexOrder order) {
+        if (order == IndexOrder::RowStrips) {
+            return buildStrip<T>(width, quadRows);
+        }
+        return buildTriangles<T>(width, quadRows, order);
+    }
+
+    /**
+     * Simulates a FIFO post-transform vertex cache to measure how well an index order reuses vertices
+     * @param strip Whether the indices are a triangle strip rather than a list. Degenerate triangles aren't counted
+     * @param cacheSize Entries in the simulated cache
+     */
+    VertexCacheStats measureVertexCache(const std::vector<unsigned int> &indices, bool strip, size_t vertexCount,
+                                        unsigned int cacheSize);
+}
+
+
+#endif //PROCGEN_INDEXBUILDER_H
@@ -0,0 +1,95 @@
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include "MappedFile.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PROCGEN_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string &path) {
+#ifdef PROCGEN_MMAP
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return;
+    }
+    struct stat info{};
+    if (fstat(file, &info) == 0 && info.st_size > 0) {
+        void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapping != MAP_FAILED) {
+            data = static_cast<const unsigned char *>(mapping);
+            size = static_cast<size_t>(info.st_size);
+        } else {
+            std::cerr << "Failed to map " << path << std::endl;
+        }
+    }
+    // The mapping keeps its own reference to the file
+    close(file);
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return;
+    }
+    contents.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char *>(contents.data()), static_cast<std::streamsize>(contents.size()))) {
+        std::cerr << "Failed to read " << path << std::endl;
+        return;
+    }
+    data = contents.data();
+    size = contents.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef PROCGEN_MMAP
+    if (data) {
+        munmap(const_cast<unsigned char *>(data), size);
+    }
+#endif
+}
+
+bool MappedFile::isOpen() const {
+    return data != nullptr;
+}
+
+const unsigned char *MappedFile::getData() const {
+    return data;
+}
+
+size_t MappedFile::getSize() const {
+    return size;
+}
+
+void MappedFile::advise(size_t offset, size_t length, FileAccess access) const {
+#ifdef PROCGEN_MMAP
+    if (!data || offset >= size) {
+        return;
+    }
+    // madvise works on whole pages
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t start = offset / pageSize * pageSize;
+    size_t end = std::min(offset + length, size);
+    int advice = MADV_NORMAL;
+    switch (access) {
+        case FileAccess::Normal:
+            advice = MADV_NORMAL;
+            break;
+        case FileAccess::Random:
+            advice = MADV_RANDOM;
+            break;
+        case FileAccess::WillNeed:
+            advice = MADV_WILLNEED;
+            break;
+        case FileAccess::DontNeed:
+            advice = MADV_DONTNEED;
+            break;
+    }
+    madvise(const_cast<unsigned char *>(data) + start, end - start, advice);
+#endif
+}
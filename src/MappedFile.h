@@ -0,0 +1,54 @@
+
+#ifndef PROCGEN_MAPPEDFILE_H
+#define PROCGEN_MAPPEDFILE_H
+
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+enum class FileAccess {
+    Normal,
+    Random, // Don't read ahead of what's touched
+    WillNeed, // Start reading these pages in now, in the background
+    DontNeed // Drop these pages, they're read again from disk if touched
+};
+
+/**
+ * A whole file mapped read only into memory. Pages are only read from disk when they're first touched, and come
+ * straight out of the page cache if the file was used recently. Where there's no mmap the file is read in instead
+ */
+class MappedFile {
+private:
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+    // Holds the contents where the file had to be read in
+    std::vector<unsigned char> contents;
+
+public:
+    /**
+     * Maps the file, check isOpen to see if it worked. Missing files aren't reported as they're expected, e.g. on a
+     * cache miss
+     */
+    explicit MappedFile(const std::string &path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool isOpen() const;
+
+    const unsigned char *getData() const;
+
+    size_t getSize() const;
+
+    /**
+     * Tells the OS how part of the file is about to be used. Only a hint, and does nothing where the file was read in
+     */
+    void advise(size_t offset, size_t length, FileAccess access) const;
+};
+
+
+#endif //PROCGEN_MAPPEDFILE_H
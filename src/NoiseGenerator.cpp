@@ -0,0 +1,113 @@
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "NoiseGenerator.h"
+#include "Random.h"
+
+NoiseGenerator::NoiseGenerator(unsigned int seed, const NoiseSettings &settings)
+        : settings(settings), noiseKernels(&noise::best()) {
+    if (settings.octaves < 1 || settings.octaves > NOISE_MAX_OCTAVES) {
+        std::cerr << "Noise octaves must be between 1 and " << NOISE_MAX_OCTAVES << ", got " << settings.octaves
+                  << std::endl;
+        NoiseGenerator::settings.octaves = std::min(std::max(settings.octaves, 1), NOISE_MAX_OCTAVES);
+    }
+
+    // Every octave gets its own seed, otherwise the octaves line up at the origin
+    Random random(seed);
+    for (uint32_t octave = 0; octave < NOISE_MAX_OCTAVES; ++octave) {
+        octaveSeeds[octave] = random.next(octave, 0);
+    }
+}
+
+void NoiseGenerator::setKernels(const noise::NoiseKernels &noiseKernels) {
+    NoiseGenerator::noiseKernels = &noiseKernels;
+}
+
+float NoiseGenerator::getHeightScale() const {
+    return settings.amplitude;
+}
+
+void NoiseGenerator::hash(Hasher &hasher) const {
+    hasher.add("Noise").add(octaveSeeds).add(settings.mode).add(settings.octaves).add(settings.frequency)
+            .add(settings.lacunarity).add(settings.gain).add(settings.amplitude);
+}
+
+void NoiseGenerator::addOctave(const float *octave, float amplitude, int count, float *out) const {
+    // Simple loops over the row, left for the compiler to vectorise
+    switch (settings.mode) {
+        case NoiseMode::Fbm:
+            for (int i = 0; i < count; ++i) {
+                out[i] += octave[i] * amplitude;
+            }
+            break;
+        case NoiseMode::Ridged:
+            for (int i = 0; i < count; ++i) {
+                float ridge = 1.f - std::abs(octave[i]);
+                out[i] += (ridge * ridge * 2.f - 1.f) * amplitude;
+            }
+            break;
+        case NoiseMode::Billow:
+            for (int i = 0; i < count; ++i) {
+                out[i] += (std::abs(octave[i]) * 2.f - 1.f) * amplitude;
+            }
+            break;
+    }
+}
+
+void NoiseGenerator::generateRow(int x, int y, int count, float *out) const {
+    std::vector<float> octave(count);
+    std::fill(out, out + count, 0.f);
+
+    float frequency = settings.frequency;
+    float amplitude = 1.f;
+    float totalAmplitude = 0.f;
+    for (int i = 0; i < settings.octaves; ++i) {
+        noiseKernels->simplexRow(x, y, frequency, count, octaveSeeds[i], octave.data());
+        addOctave(octave.data(), amplitude, count, out);
+        totalAmplitude += amplitude;
+        frequency *= settings.lacunarity;
+        amplitude *= settings.gain;
+    }
+
+    float scale = settings.amplitude / totalAmplitude;
+    for (int i = 0; i < count; ++i) {
+        out[i] *= scale;
+    }
+}
+
+void NoiseGenerator::generatePoints(const float *x, const float *y, int count, float *out) const {
+    assert(count <= NOISE_MAX_POINTS);
+    float octave[NOISE_MAX_POINTS];
+    float pointX[NOISE_MAX_POINTS];
+    float pointY[NOISE_MAX_POINTS];
+    std::fill(out, out + count, 0.f);
+
+    float frequency = settings.frequency;
+    float amplitude = 1.f;
+    float totalAmplitude = 0.f;
+    for (int i = 0; i < settings.octaves; ++i) {
+        for (int p = 0; p < count; ++p) {
+            pointX[p] = x[p] * frequency;
+            pointY[p] = y[p] * frequency;
+        }
+        noiseKernels->simplexPoints(pointX, pointY, count, octaveSeeds[i], octave);
+        addOctave(octave, amplitude, count, out);
+        totalAmplitude += amplitude;
+        frequency *= settings.lacunarity;
+        amplitude *= settings.gain;
+    }
+
+    float scale = settings.amplitude / totalAmplitude;
+    for (int i = 0; i < count; ++i) {
+        out[i] *= scale;
+    }
+}
+
+void NoiseGenerator::generate(HeightField &field, int originX, int originY) const {
+    generateRows(field, originX, originY, [this](int x, int y, int count, float *out) {
+        generateRow(x, y, count, out);
+    });
+}
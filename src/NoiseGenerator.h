@@ -0,0 +1,71 @@
+
+#ifndef PROCGEN_NOISEGENERATOR_H
+#define PROCGEN_NOISEGENERATOR_H
+
+
+#include <cstdint>
+#include "HeightGenerator.h"
+#include "NoiseKernels.h"
+
+#define NOISE_MAX_OCTAVES 16
+#define NOISE_MAX_POINTS 64
+
+enum class NoiseMode {
+    Fbm, // Octaves added up as they are, rolling hills
+    Ridged, // Each octave folded into sharp ridges along its zero crossings, mountain ranges
+    Billow // Each octave folded into rounded lumps, puffy hills and dunes
+};
+
+struct NoiseSettings {
+    NoiseMode mode = NoiseMode::Fbm;
+    int octaves = 6;
+    float frequency = 1.f / 128.f; // Cycles per sample for the first octave
+    float lacunarity = 2.f; // Frequency multiplier from one octave to the next
+    float gain = .5f; // Amplitude multiplier from one octave to the next
+    float amplitude = 7.f; // Heights stay within +-amplitude
+};
+
+/**
+ * Fractal simplex noise height generator. Every sample depends only on its world position, so fields can be any size,
+ * start anywhere and always line up with their neighbours without any special edge handling.
+ * Rows are generated a whole octave at a time by the SIMD row kernels
+ */
+class NoiseGenerator : public HeightGenerator {
+private:
+    NoiseSettings settings;
+    uint32_t octaveSeeds[NOISE_MAX_OCTAVES];
+    const noise::NoiseKernels *noiseKernels;
+
+    /**
+     * Folds one octave of noise according to the mode and adds it on to out
+     */
+    void addOctave(const float *octave, float amplitude, int count, float *out) const;
+
+public:
+    NoiseGenerator(unsigned int seed, const NoiseSettings &settings);
+
+    void generate(HeightField &field, int originX = 0, int originY = 0) const override;
+
+    float getHeightScale() const override;
+
+    void hash(Hasher &hasher) const override;
+
+    /**
+     * Heights for one row of the world: out[i] is the height at (x + i, y)
+     */
+    void generateRow(int x, int y, int count, float *out) const;
+
+    /**
+     * Heights at arbitrary points in the world, in samples. Same as generateRow for points on the grid
+     * @param x Up to NOISE_MAX_POINTS points
+     */
+    void generatePoints(const float *x, const float *y, int count, float *out) const;
+
+    /**
+     * Overrides the noise kernels picked for this CPU, e.g. to compare against the scalar reference
+     */
+    void setKernels(const noise::NoiseKernels &noiseKernels);
+};
+
+
+#endif //PROCGEN_NOISEGENERATOR_H
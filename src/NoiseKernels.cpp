@@ -0,0 +1,201 @@
+
+#include <cmath>
+#include "NoiseKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(__GNUC__) || defined(__clang__)
+#define PROCGEN_NOISE_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+namespace noise {
+    namespace {
+        const float skew = .366025403784f; // (sqrt(3) - 1) / 2, squashes the square grid onto triangles
+        const float unskew = .211324865405f; // (3 - sqrt(3)) / 6
+        const float unskewTwice = unskew * 2.f;
+        const float outputScale = 45.f; // Brings the sum of the three corners to roughly [-1, 1]
+
+        // Integer hash of a lattice point, stands in for the usual permutation table
+        const uint32_t hashX = 0x27d4eb2du;
+        const uint32_t hashY = 0x165667b1u;
+        const uint32_t hashMix = 0x2c1b3c6du;
+
+        inline uint32_t hash(int32_t i, int32_t j, uint32_t seed) {
+            uint32_t h = seed ^ (static_cast<uint32_t>(i) * hashX) ^ (static_cast<uint32_t>(j) * hashY);
+            h ^= h >> 15;
+            h *= hashMix;
+            h ^= h >> 12;
+            return h;
+        }
+
+        /**
+         * Dot product of the offset with one of the eight gradients (±1, ±2) and (±2, ±1)
+         */
+        inline float gradient(uint32_t h, float x, float y) {
+            float u = h & 4 ? y : x;
+            float v = h & 4 ? x : y;
+            u = h & 1 ? -u : u;
+            v = h & 2 ? -v : v;
+            return u + (v + v);
+        }
+
+        /**
+         * Contribution of one corner of the triangle, falls off to nothing half a unit away
+         */
+        inline float corner(uint32_t h, float x, float y) {
+            float t = .5f - x * x - y * y;
+            // Same as max(t, 0) in SIMD, which gives 0 for -0 and NaN
+            t = t > 0.f ? t : 0.f;
+            t *= t;
+            return t * t * gradient(h, x, y);
+        }
+
+        inline float simplex(float x, float y, uint32_t seed) {
+            // Find the triangle the point is in
+            float s = (x + y) * skew;
+            float cellX = std::floor(x + s);
+            float cellY = std::floor(y + s);
+            float t = (cellX + cellY) * unskew;
+            float x0 = x - (cellX - t);
+            float y0 = y - (cellY - t);
+            auto i = static_cast<int32_t>(cellX);
+            auto j = static_cast<int32_t>(cellY);
+
+            // Lower or upper triangle of the cell decides the middle corner
+            bool lower = x0 > y0;
+            float x1 = (x0 - (lower ? 1.f : 0.f)) + unskew;
+            float y1 = (y0 - (lower ? 0.f : 1.f)) + unskew;
+            float x2 = (x0 - 1.f) + unskewTwice;
+            float y2 = (y0 - 1.f) + unskewTwice;
+
+            float n = corner(hash(i, j, seed), x0, y0);
+            n += corner(hash(i + (lower ? 1 : 0), j + (lower ? 0 : 1), seed), x1, y1);
+            n += corner(hash(i + 1, j + 1, seed), x2, y2);
+            return n * outputScale;
+        }
+
+        void simplexRowScalar(int x, int y, float frequency, int count, uint32_t seed, float *out) {
+            float pointY = static_cast<float>(y) * frequency;
+            for (int i = 0; i < count; ++i) {
+                out[i] = simplex(static_cast<float>(x + i) * frequency, pointY, seed);
+            }
+        }
+
+        void simplexPointsScalar(const float *x, const float *y, int count, uint32_t seed, float *out) {
+            for (int i = 0; i < count; ++i) {
+                out[i] = simplex(x[i], y[i], seed);
+            }
+        }
+
+#ifdef PROCGEN_NOISE_AVX2
+        // Like the diamond-square kernels only AVX2 is enabled, not FMA, so nothing gets fused and rounded differently
+
+        __attribute__((target("avx2")))
+        inline __m256i hashAvx2(__m256i i, __m256i j, __m256i seed) {
+            __m256i h = _mm256_xor_si256(seed, _mm256_xor_si256(_mm256_mullo_epi32(i, _mm256_set1_epi32(hashX)),
+                                                                _mm256_mullo_epi32(j, _mm256_set1_epi32(hashY))));
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+            h = _mm256_mullo_epi32(h, _mm256_set1_epi32(hashMix));
+            return _mm256_xor_si256(h, _mm256_srli_epi32(h, 12));
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256 cornerAvx2(__m256i h, __m256 x, __m256 y) {
+            // Gradient picked with blends, and the signs flipped by moving the hash bits into the sign bit
+            __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(h, _mm256_set1_epi32(4)),
+                                                                 _mm256_set1_epi32(4)));
+            __m256 u = _mm256_blendv_ps(x, y, swap);
+            __m256 v = _mm256_blendv_ps(y, x, swap);
+            u = _mm256_xor_ps(u, _mm256_castsi256_ps(
+                    _mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31)));
+            v = _mm256_xor_ps(v, _mm256_castsi256_ps(
+                    _mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30)));
+            __m256 gradient = _mm256_add_ps(u, _mm256_add_ps(v, v));
+
+            __m256 t = _mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(.5f), _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y));
+            t = _mm256_max_ps(t, _mm256_setzero_ps());
+            t = _mm256_mul_ps(t, t);
+            return _mm256_mul_ps(_mm256_mul_ps(t, t), gradient);
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256 simplexAvx2(__m256 pointX, __m256 pointY, __m256i seeds) {
+            const __m256 one = _mm256_set1_ps(1.f);
+            const __m256i oneInt = _mm256_set1_epi32(1);
+
+            __m256 s = _mm256_mul_ps(_mm256_add_ps(pointX, pointY), _mm256_set1_ps(skew));
+            __m256 cellX = _mm256_floor_ps(_mm256_add_ps(pointX, s));
+            __m256 cellY = _mm256_floor_ps(_mm256_add_ps(pointY, s));
+            __m256 t = _mm256_mul_ps(_mm256_add_ps(cellX, cellY), _mm256_set1_ps(unskew));
+            __m256 x0 = _mm256_sub_ps(pointX, _mm256_sub_ps(cellX, t));
+            __m256 y0 = _mm256_sub_ps(pointY, _mm256_sub_ps(cellY, t));
+            __m256i cellI = _mm256_cvttps_epi32(cellX);
+            __m256i cellJ = _mm256_cvttps_epi32(cellY);
+
+            // All ones in the lower triangle, which also steps the integer coordinates by subtracting it
+            __m256 lower = _mm256_cmp_ps(x0, y0, _CMP_GT_OQ);
+            __m256i lowerInt = _mm256_castps_si256(lower);
+            __m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_and_ps(lower, one)), _mm256_set1_ps(unskew));
+            __m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_andnot_ps(lower, one)), _mm256_set1_ps(unskew));
+            __m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, one), _mm256_set1_ps(unskewTwice));
+            __m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, one), _mm256_set1_ps(unskewTwice));
+
+            __m256 n = cornerAvx2(hashAvx2(cellI, cellJ, seeds), x0, y0);
+            n = _mm256_add_ps(n, cornerAvx2(hashAvx2(_mm256_sub_epi32(cellI, lowerInt),
+                                                     _mm256_add_epi32(_mm256_add_epi32(cellJ, oneInt), lowerInt),
+                                                     seeds), x1, y1));
+            n = _mm256_add_ps(n, cornerAvx2(hashAvx2(_mm256_add_epi32(cellI, oneInt),
+                                                     _mm256_add_epi32(cellJ, oneInt), seeds), x2, y2));
+            return _mm256_mul_ps(n, _mm256_set1_ps(outputScale));
+        }
+
+        __attribute__((target("avx2")))
+        void simplexRowAvx2(int x, int y, float frequency, int count, uint32_t seed, float *out) {
+            const __m256 frequencies = _mm256_set1_ps(frequency);
+            const __m256i seeds = _mm256_set1_epi32(static_cast<int>(seed));
+            const __m256 pointY = _mm256_set1_ps(static_cast<float>(y) * frequency);
+            const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 pointX = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x + i), lanes)),
+                                              frequencies);
+                _mm256_storeu_ps(out + i, simplexAvx2(pointX, pointY, seeds));
+            }
+            simplexRowScalar(x + i, y, frequency, count - i, seed, out + i);
+        }
+
+        __attribute__((target("avx2")))
+        void simplexPointsAvx2(const float *x, const float *y, int count, uint32_t seed, float *out) {
+            const __m256i seeds = _mm256_set1_epi32(static_cast<int>(seed));
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                _mm256_storeu_ps(out + i, simplexAvx2(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), seeds));
+            }
+            simplexPointsScalar(x + i, y + i, count - i, seed, out + i);
+        }
+#endif
+
+        const NoiseKernels scalarKernels{"scalar", simplexRowScalar, simplexPointsScalar};
+
+        const NoiseKernels &detect() {
+#ifdef PROCGEN_NOISE_AVX2
+            static const NoiseKernels avx2Kernels{"avx2", simplexRowAvx2, simplexPointsAvx2};
+            if (__builtin_cpu_supports("avx2")) {
+                return avx2Kernels;
+            }
+#endif
+            return scalarKernels;
+        }
+    }
+
+    const NoiseKernels &scalar() {
+        return scalarKernels;
+    }
+
+    const NoiseKernels &best() {
+        static const NoiseKernels &kernels = detect();
+        return kernels;
+    }
+}
@@ -0,0 +1,44 @@
+
+#ifndef PROCGEN_NOISEKERNELS_H
+#define PROCGEN_NOISEKERNELS_H
+
+
+#include <cstdint>
+
+/**
+ * Row kernels for 2D simplex noise. Every sample is a pure function of its coordinates and the seed, there is no
+ * permutation table or other state, so any row of any chunk can be evaluated on any thread. All implementations do
+ * the same float operations in the same order so they give bit identical results.
+ */
+namespace noise {
+    /**
+     * Simplex noise along one row: out[i] = simplex((x + i) * frequency, y * frequency), roughly in [-1, 1].
+     * Coordinates are integers so a sample comes out the same whichever row or chunk it's evaluated as part of
+     */
+    typedef void (*SimplexRowFn)(int x, int y, float frequency, int count, uint32_t seed, float *out);
+
+    /**
+     * Simplex noise at arbitrary points: out[i] = simplex(x[i], y[i]). For when the points don't sit on a grid, e.g.
+     * after domain warping. Matches the row kernel exactly given the same coordinates
+     */
+    typedef void (*SimplexPointsFn)(const float *x, const float *y, int count, uint32_t seed, float *out);
+
+    struct NoiseKernels {
+        const char *name;
+        SimplexRowFn simplexRow;
+        SimplexPointsFn simplexPoints;
+    };
+
+    /**
+     * Plain C++ reference kernels
+     */
+    const NoiseKernels &scalar();
+
+    /**
+     * The fastest kernels the current CPU supports, picked the first time this is called
+     */
+    const NoiseKernels &best();
+}
+
+
+#endif //PROCGEN_NOISEKERNELS_H
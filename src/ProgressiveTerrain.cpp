@@ -0,0 +1,83 @@
+
+#include <iostream>
+#include "ProgressiveTerrain.h"
+#include "ThreadPool.h"
+
+ProgressiveTerrain::ProgressiveTerrain(std::shared_ptr<const DiamondSquare> generator, unsigned int size,
+                                       unsigned int firstSize, Shader *shader, Material &material)
+        : size(size), shader(shader), material(material), refined(new Refined) {
+    // Each level halves the spacing, so only a power of two spacing ends up at the full size
+    unsigned int spacing = firstSize >= 2 && firstSize <= size && (size - 1) % (firstSize - 1) == 0 ?
+                           (size - 1) / (firstSize - 1) : 0;
+    if (spacing == 0 || (spacing & (spacing - 1)) != 0) {
+        std::cerr << "The first level of a " << size << " map has to be 2^n+1 up to its size, spaced a power of two "
+                     "apart, not " << firstSize << std::endl;
+        firstSize = size;
+        spacing = 1;
+    }
+    HeightField first(firstSize);
+    float randMax = generator->generateGrid(first, static_cast<int>(spacing));
+    // Every level textures against the first one's range, otherwise the sand/grass blend would jump with each swap
+    first.getRange(minY, maxY);
+    if (spacing > 1) {
+        auto refined = this->refined;
+        ThreadPool::global().submit([refined, generator, first, spacing, randMax]() mutable {
+            HeightField coarse = std::move(first);
+            for (int levelSpacing = static_cast<int>(spacing) / 2; levelSpacing >= 1; levelSpacing /= 2) {
+                if (refined->cancelled) {
+                    return;
+                }
+                HeightField level((coarse.getSize() - 1) * 2 + 1);
+                randMax = generator->refineGrid(level, coarse, levelSpacing, randMax);
+                coarse = std::move(level);
+                // Nothing refines the last level, so it doesn't need keeping
+                HeightField finished = levelSpacing > 1 ? coarse : std::move(coarse);
+
+                std::lock_guard<std::mutex> lock(refined->mutex);
+                refined->levels.push_back(std::move(finished));
+            }
+        });
+    }
+    show(std::move(first));
+}
+
+ProgressiveTerrain::~ProgressiveTerrain() {
+    refined->cancelled = true;
+    delete terrain;
+}
+
+void ProgressiveTerrain::show(HeightField level) {
+    auto stretch = static_cast<float>(size - 1) / static_cast<float>(level.getSize() - 1);
+    delete terrain;
+    terrain = new Terrain(std::move(level), shader, material);
+    terrain->setScale(glm::vec3(stretch, 1.f, stretch));
+    terrain->setHeightRange(minY, maxY);
+}
+
+void ProgressiveTerrain::update() {
+    std::vector<HeightField> levels;
+    {
+        std::lock_guard<std::mutex> lock(refined->mutex);
+        levels.swap(refined->levels);
+    }
+    // Uploads are what stall the frame, so if several levels finished at once only the finest goes up
+    if (!levels.empty()) {
+        show(std::move(levels.back()));
+    }
+}
+
+void ProgressiveTerrain::render() {
+    terrain->render();
+}
+
+BoundingBox ProgressiveTerrain::getBounds() const {
+    return terrain->getBounds();
+}
+
+unsigned int ProgressiveTerrain::getLevelSize() const {
+    return terrain->getHeightField().getSize();
+}
+
+bool ProgressiveTerrain::isComplete() const {
+    return getLevelSize() == size;
+}
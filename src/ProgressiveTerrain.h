@@ -0,0 +1,77 @@
+
+#ifndef PROCGEN_PROGRESSIVETERRAIN_H
+#define PROCGEN_PROGRESSIVETERRAIN_H
+
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "DiamondSquare.h"
+#include "Terrain.h"
+
+/**
+ * One large diamond-square map that shows up straight away and sharpens as it's generated.
+ *
+ * Diamond-square builds a map one level at a time, each doubling the samples along a side, so the first few levels are
+ * a complete coarse version of the map. Only those are generated before the first frame, which takes the same time
+ * whatever the size of the map. Each finer level is then run on the thread pool from the one before and swapped in,
+ * stretched over the same ground, as it finishes. In seamless mode every level is exactly every n-th sample of the
+ * full map, so hills sharpen in place rather than moving
+ */
+class ProgressiveTerrain {
+private:
+    // Shared with the refinement task, so it stays alive if the terrain is destroyed with the task still running
+    struct Refined {
+        std::mutex mutex;
+        std::vector<HeightField> levels;
+        std::atomic<bool> cancelled{false};
+    };
+
+    unsigned int size;
+    Shader *shader;
+    Material material;
+    Terrain *terrain = nullptr;
+    float minY, maxY;
+    std::shared_ptr<Refined> refined;
+
+    /**
+     * Replaces the drawn terrain with a level, stretched to the size of the full map
+     */
+    void show(HeightField level);
+
+public:
+    /**
+     * @param size Samples along one side of the full map, 2^n+1
+     * @param firstSize Samples along one side of the level generated before the first frame, 2^n+1 up to size
+     */
+    ProgressiveTerrain(std::shared_ptr<const DiamondSquare> generator, unsigned int size, unsigned int firstSize,
+                       Shader *shader, Material &material);
+
+    ~ProgressiveTerrain();
+
+    /**
+     * Swaps in the finest level finished since the last call. Should be called once a frame, as it uploads
+     */
+    void update();
+
+    void render();
+
+    /**
+     * @return World space bounds of the level being drawn
+     */
+    BoundingBox getBounds() const;
+
+    /**
+     * @return Samples along one side of the level being drawn
+     */
+    unsigned int getLevelSize() const;
+
+    /**
+     * @return True once the full map is being drawn
+     */
+    bool isComplete() const;
+};
+
+
+#endif //PROCGEN_PROGRESSIVETERRAIN_H
@@ -0,0 +1,94 @@
+
+#ifndef PROCGEN_RANDOM_H
+#define PROCGEN_RANDOM_H
+
+#include <cstdint>
+
+/**
+ * Stateless counter-based random number generator (Widynski's "Squares" generator).
+ * Every value is a pure function of (seed, stream, counter), so values can be generated on any thread, in any order,
+ * and will always match. Terrain uses the step size as the stream and packs (x, y) into the counter, trees use the
+ * axis as the stream and the attraction point index as the counter.
+ */
+class Random {
+private:
+    uint64_t seed;
+
+    static uint64_t splitMix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    static float toUnit(uint32_t value) {
+        // Top 24 bits gives every float in [0, 1) an equal chance
+        return static_cast<float>(value >> 8) * (1.f / 16777216.f);
+    }
+
+public:
+    explicit Random(uint64_t seed) : seed(seed) {}
+
+    uint64_t getSeed() const {
+        return seed;
+    }
+
+    /**
+     * Packs a grid position into a counter
+     */
+    static uint64_t counter(int x, int y) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(y)) << 32) | static_cast<uint32_t>(x);
+    }
+
+    /**
+     * Squares32 round function
+     * @param key Stream key, see getKey
+     * @param ctr Counter
+     */
+    static uint32_t squares(uint64_t key, uint64_t ctr) {
+        uint64_t x, y, z;
+        y = x = ctr * key;
+        z = y + key;
+        x = x * x + y;
+        x = (x >> 32) | (x << 32);
+        x = x * x + z;
+        x = (x >> 32) | (x << 32);
+        x = x * x + y;
+        x = (x >> 32) | (x << 32);
+        return static_cast<uint32_t>((x * x + z) >> 32);
+    }
+
+    /**
+     * Gets the key for a stream of numbers from this seed. Keys are forced odd as the generator requires
+     */
+    uint64_t getKey(uint32_t stream) const {
+        return splitMix(seed ^ splitMix(stream)) | 1ull;
+    }
+
+    uint32_t next(uint32_t stream, uint64_t ctr) const {
+        return squares(getKey(stream), ctr);
+    }
+
+    /**
+     * @return A float from min to max for this stream and counter. Float rounding can give exactly max
+     */
+    float uniform(uint32_t stream, uint64_t ctr, float min, float max) const {
+        return min + (max - min) * toUnit(next(stream, ctr));
+    }
+
+    /**
+     * Fills out with values for the grid positions (x + i * xStride, y) for i in [0, count).
+     * Works out the key once for the whole row, each value is then the same scalar squares() call as next()
+     */
+    void uniformRow(uint32_t stream, int x, int xStride, int y, int count, float min, float max, float *out) const {
+        uint64_t key = getKey(stream);
+        uint64_t row = static_cast<uint64_t>(static_cast<uint32_t>(y)) << 32;
+        float range = max - min;
+        for (int i = 0; i < count; ++i) {
+            auto ctr = row | static_cast<uint32_t>(x + i * xStride);
+            out[i] = min + range * toUnit(squares(key, ctr));
+        }
+    }
+};
+
+#endif //PROCGEN_RANDOM_H
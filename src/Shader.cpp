@@ -7,7 +7,7 @@
 #include "Light.h"
 #include "glHelper.h"
 
-Shader::Shader(const char *vertexFile, const char *fragFile) {
+Shader::Shader(const char *vertexFile, const char *fragFile, const char *defines) {
     // Load shaders from source
     std::ifstream file;
     std::string line;
@@ -21,6 +21,10 @@ Shader::Shader(const char *vertexFile, const char *fragFile) {
     }
     while (getline(file, line)) {
         vertexSrc += line + "\n";
+        // Defines have to come after #version
+        if (line.compare(0, 8, "#version") == 0) {
+            vertexSrc += defines;
+        }
     }
     file.close();
 
@@ -32,6 +36,9 @@ Shader::Shader(const char *vertexFile, const char *fragFile) {
     }
     while (getline(file, line)) {
         fragmentSrc += line + "\n";
+        if (line.compare(0, 8, "#version") == 0) {
+            fragmentSrc += defines;
+        }
     }
     file.close();
 
@@ -132,3 +139,15 @@ void Shader::setUniform<float>(const char *name, float value) {
     glUniform1f(glGetUniformLocation(program, name), value);
     GLERRCHECK();
 }
+
+template <>
+void Shader::setUniform<glm::vec2>(const char *name, glm::vec2 value) {
+    glUniform2fv(glGetUniformLocation(program, name), 1, glm::value_ptr(value));
+    GLERRCHECK();
+}
+
+template <>
+void Shader::setUniform<glm::vec3>(const char *name, glm::vec3 value) {
+    glUniform3fv(glGetUniformLocation(program, name), 1, glm::value_ptr(value));
+    GLERRCHECK();
+}
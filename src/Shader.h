@@ -17,7 +17,10 @@ private:
 
     bool checkShaderCompile(GLuint shader);
 public:
-    Shader(const char *vertexFile, const char *fragFile);
+    /**
+     * @param defines Extra source inserted after the #version line of both shaders, e.g. "#define FOO\n"
+     */
+    Shader(const char *vertexFile, const char *fragFile, const char *defines = "");
 
     void use();
 
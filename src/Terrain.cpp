@@ -1,37 +1,27 @@
 
+#include <algorithm>
+#include <cstddef>
 #include <ext/matrix_transform.hpp>
 #include <iostream>
 #include "Terrain.h"
 
 #define TEX_SCALE .75f
 
-std::default_random_engine Terrain::generator;
-
-Terrain::Terrain(unsigned short size, float maxRand, float h, Shader *shader, Material &material)
-        : size(size), maxRand(maxRand), h(h), shader(shader), material(material) {
-    data = new Vertex[size * size];
-
-    // Generate initial data
-    for (int x = 0; x < size; ++x) {
-        for (int z = 0; z < size; ++z) {
-            getValue(x, z).position.x = x;
-            getValue(x, z).position.y = 0.f;
-            getValue(x, z).position.z = z;
-            getValue(x, z).normal.x = 0.f;
-            getValue(x, z).normal.y = 0.f;
-            getValue(x, z).normal.z = 0.f;
-        }
+namespace {
+    HeightField generateHeights(unsigned short size, const HeightGenerator &generator, HeightLayout layout) {
+        HeightField heightField(size, layout);
+        generator.generate(heightField);
+        return heightField;
     }
+}
 
-    // Generate terrain
-    std::uniform_real_distribution<float> distribution(-maxRand, maxRand);
-    getValue(0, 0).position.y = distribution(generator);
-    getValue(0, size - 1).position.y = distribution(generator);
-    getValue(size - 1, size - 1).position.y = distribution(generator);
-    getValue(size - 1, 0).position.y = distribution(generator);
-
-    diamondSquare(size - 1, maxRand);
+Terrain::Terrain(unsigned short size, const HeightGenerator &generator, Shader *shader, Material &material,
+                 HeightLayout layout, IndexMode indexMode)
+        : Terrain(generateHeights(size, generator, layout), shader, material, indexMode) {}
 
+Terrain::Terrain(HeightField heightField, Shader *shader, Material &material, IndexMode indexMode)
+        : material(material), indexMode(indexMode), size(heightField.getSize()), heightField(std::move(heightField)),
+          shader(shader) {
     buildBuffers();
 
     // Set world transform
@@ -41,24 +31,124 @@ Terrain::Terrain(unsigned short size, float maxRand, float h, Shader *shader, Ma
     updateModelMatrix();
 }
 
-Vertex &Terrain::getValue(int x, int y) {
-    assert(x < size);
-    assert(y < size);
+Terrain::~Terrain() {
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    IndexBufferCache::global().release(indexBuffer);
+#ifdef HEIGHT_ONLY_VERTICES
+    glDeleteTextures(1, &heightTexture);
+#endif
+}
+
+float &Terrain::getHeight(int x, int y) {
+    return heightField.at(x, y);
+}
+
+HeightField &Terrain::getHeightField() {
+    return heightField;
+}
+
+void Terrain::applyBrush(const Brush &brush, float x, float z) {
+    markDirty(::applyBrush(heightField, brush, x, z));
+}
+
+void Terrain::markDirty(const DirtyRect &rect) {
+    dirty.add(rect);
+}
+
+void Terrain::uploadDirty() {
+#ifdef HEIGHT_ONLY_VERTICES
+    // Normals are worked out in the shader, so just the edited heights go up
+    heightField.forEachIn(dirty.x0, dirty.y0, dirty.x1, dirty.y1, [&](int x, int y, float height) {
+        if (!heightRangeSet) {
+            minY = std::min(minY, height);
+            maxY = std::max(maxY, height);
+        }
+        localBounds.min.y = std::min(localBounds.min.y, height);
+        localBounds.max.y = std::max(localBounds.max.y, height);
+    });
+    uploadHeights(dirty);
+    dirty = {0, 0, 0, 0};
+#else
+    // Normals read the neighbouring samples, so the ring around the edit changes too
+    int fieldSize = size;
+    auto rect = dirty.expanded(1, fieldSize);
+    dirty = {0, 0, 0, 0};
+
+    int width = rect.x1 - rect.x0;
+    float low, high;
+#ifdef COMPACT_VERTICES
+    low = heightField.at(rect.x0, rect.y0);
+    high = low;
+    heightField.forEachIn(rect.x0, rect.y0, rect.x1, rect.y1, [&](int x, int y, float height) {
+        low = std::min(low, height);
+        high = std::max(high, height);
+    });
+    if (low < quantMinY || high > quantMaxY) {
+        // Edited outside the quantisation range, everything has to be quantised again
+        quantMinY = std::min(quantMinY, low);
+        quantMaxY = std::max(quantMaxY, high);
+        rect = {0, 0, fieldSize, fieldSize};
+        width = fieldSize;
+    }
+    std::vector<CompactVertex> vertices(static_cast<size_t>(width) * (rect.y1 - rect.y0));
+    terrainMesh::buildCompactVertices(heightField, rect, quantMinY, quantMaxY, vertices.data());
+#else
+    std::vector<Vertex> vertices(static_cast<size_t>(width) * (rect.y1 - rect.y0));
+    terrainMesh::buildVertices(heightField, TEX_SCALE, rect, vertices.data(), low, high);
+#endif
+    // The texturing range only ever grows, finding the new range exactly would mean scanning the whole field. A range
+    // shared with other terrains stays as it was set, so they keep matching
+    if (!heightRangeSet) {
+        minY = std::min(minY, low);
+        maxY = std::max(maxY, high);
+    }
+    localBounds.min.y = std::min(localBounds.min.y, low);
+    localBounds.max.y = std::max(localBounds.max.y, high);
 
-    return data[size * y + x];
+    size_t vertexSize = sizeof(vertices[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (width == fieldSize) {
+        // Whole rows are contiguous in the buffer
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(fieldSize) * rect.y0 * vertexSize,
+                        vertices.size() * vertexSize, vertices.data());
+        return;
+    }
+    for (int y = rect.y0; y < rect.y1; ++y) {
+        glBufferSubData(GL_ARRAY_BUFFER, (static_cast<GLintptr>(fieldSize) * y + rect.x0) * vertexSize,
+                        width * vertexSize, &vertices[static_cast<size_t>(width) * (y - rect.y0)]);
+    }
+#endif
 }
 
-Vertex *Terrain::getData() {
-    return data;
+BoundingBox Terrain::getBounds() const {
+    return localBounds.transformed(modelMatrix);
 }
 
 void Terrain::render() {
+    if (!dirty.empty()) {
+        uploadDirty();
+    }
+
     shader->use();
     shader->setUniform("model", modelMatrix);
     shader->setUniform("normalMat", glm::transpose(glm::inverse(glm::mat3(modelMatrix))));
     shader->setMaterial(material);
     shader->setUniform("minY", minY);
     shader->setUniform("maxY", maxY);
+#ifdef COMPACT_VERTICES
+    shader->setUniform("gridSize", static_cast<int>(size));
+    shader->setUniform("heightRange", glm::vec2(quantMinY, quantMaxY - quantMinY));
+    shader->setUniform("uvScale", static_cast<float>(size) * TEX_SCALE / static_cast<float>(size - 1));
+#elif defined(HEIGHT_ONLY_VERTICES)
+    shader->setUniform("gridSize", static_cast<int>(size));
+    shader->setUniform("uvScale", static_cast<float>(size) * TEX_SCALE / static_cast<float>(size - 1));
+    // Heights go after the material's textures
+    auto heightUnit = static_cast<int>(material.textures.size());
+    glActiveTexture(GL_TEXTURE0 + heightUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, heightTexture);
+    shader->setUniform("heights", heightUnit);
+#endif
 
     // Bind textures
     for (int i = 0; i < material.textures.size(); ++i) {
@@ -68,116 +158,47 @@ void Terrain::render() {
     }
 
     glBindVertexArray(vao);
-    glDrawElements(mode, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_SHORT, nullptr);
+    indexBuffer->draw();
 }
 
 void Terrain::buildBuffers() {
-    // Generate triangle strip indices
-    mode = GL_TRIANGLE_STRIP;
-    for (unsigned short y = 0; y < size - 1; ++y) {
-        for (unsigned short x = 0; x < size; ++x) {
-            indices.push_back((y * size) + x);
-            indices.push_back((y * size) + x + size);
-        }
-        // Degenerate triangles
-        indices.push_back((y * size) + size + size - (unsigned short) 1);
-        indices.push_back((y * size) + size);
-    }
-
-    // Remove last two which are degenerates
-    indices.pop_back();
-    indices.pop_back();
-
-    // Generate UVs
-    float uScale = static_cast<float>(size) * TEX_SCALE;
-    float vScale = static_cast<float>(size) * TEX_SCALE;
-    for (int x = 0; x < size; ++x) {
-        for (int y = 0; y < size; ++y) {
-            // Calculate min and max y
-            if (getValue(x, y).position.y > maxY) {
-                maxY = getValue(x, y).position.y;
-            } else if (getValue(x, y).position.y < minY) {
-                minY = getValue(x, y).position.y;
-            }
-
-            getValue(x, y).uv.x = uScale * (static_cast<float>(x) / static_cast<float>(size - 1));
-            getValue(x, y).uv.y = vScale * (static_cast<float>(y) / static_cast<float>(size - 1));
-        }
-    }
-
-    // Generate normals
-
-    // Normals per quad (which is made of two triangles)
-    glm::vec3 quadNormals[size - 1][size - 1][2];
-
-    // Calculate the normals per quad (and their two triangles)
-    for (int x = 0; x < size - 1; ++x) {
-        for (int y = 0; y < size - 1; ++y) {
-            // First triangle
-            auto vert1 = getValue(x, y).position;
-            auto vert2 = getValue(x, y+1).position;
-            auto vert3 = getValue(x+1, y).position;
-
-            auto normal = glm::cross(vert1 - vert2, vert1 - vert3);
-            normal += glm::cross(vert2 - vert3, vert2 - vert1);
-            normal += glm::cross(vert3 - vert1, vert3 - vert2);
-
-            quadNormals[x][y][0] = normal;
-
-            // Second triangle
-            vert1 = getValue(x+1, y+1).position;
-            vert2 = getValue(x+1, y).position;
-            vert3 = getValue(x, y+1).position;
-
-            normal = glm::cross(vert1 - vert2, vert1 - vert3);
-            normal += glm::cross(vert2 - vert3, vert2 - vert1);
-            normal += glm::cross(vert3 - vert1, vert3 - vert2);
-
-            quadNormals[x][y][1] = normal;
-        }
-    }
-
-    // Calculate normal per vertex based upon previous calculation
-    for (int x = 0; x < size; ++x) {
-        for (int y = 0; y < size; ++y) {
-            glm::vec3 normal(0.f);
-            if (y > 0) {
-                // Get top left quad, second triangle
-                if (x > 0) {
-                    normal += quadNormals[x-1][y-1][1];
-                }
-                // Top right quad, both triangles
-                if (x < size - 1) {
-                    normal += quadNormals[x][y-1][0];
-                    normal += quadNormals[x][y-1][1];
-                }
-            }
-            if (y < size - 1) {
-                // Bottom left quad, both triangles
-                if (x > 0) {
-                    normal += quadNormals[x-1][y][0];
-                    normal += quadNormals[x-1][y][1];
-                }
-                // Bottom right quad, first triangle
-                if (x < size - 1) {
-                    normal += quadNormals[x][y][0];
-                }
-            }
-
-            // Set actual normal
-            normal = glm::normalize(normal);
-            getValue(x, y).normal = normal;
-        }
-    }
-
     // Generate VAO
     glGenVertexArrays(1, &vao);
     glBindVertexArray(vao);
-
-    // Vertex data
     glGenBuffers(1, &vbo);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, getSize() * sizeof(Vertex), getData(), GL_STATIC_DRAW);
+
+    // Vertex data only lives long enough to be uploaded
+#ifdef COMPACT_VERTICES
+    heightField.getRange(minY, maxY);
+    quantMinY = minY;
+    quantMaxY = maxY;
+    int fieldSize = size;
+    std::vector<CompactVertex> vertices(getSize());
+    terrainMesh::buildCompactVertices(heightField, {0, 0, fieldSize, fieldSize}, quantMinY, quantMaxY,
+                                      vertices.data());
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(CompactVertex), vertices.data(), GL_STATIC_DRAW);
+    // Height
+    glVertexAttribPointer(0, 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), nullptr);
+    glEnableVertexAttribArray(0);
+    // Normals
+    glVertexAttribPointer(1, 2, COMPACT_NORMAL_BITS == 16 ? GL_SHORT : GL_BYTE, GL_TRUE, sizeof(CompactVertex),
+                          (void *)offsetof(CompactVertex, normal));
+    glEnableVertexAttribArray(1);
+#elif defined(HEIGHT_ONLY_VERTICES)
+    // No vertex assembly at all, the heights go up as they are and the vertex shader reads them through a buffer
+    // texture, so it can also read the neighbours it needs for the normal
+    heightField.getRange(minY, maxY);
+    int fieldSize = size;
+    glBufferData(GL_ARRAY_BUFFER, getSize() * sizeof(float), nullptr, GL_STATIC_DRAW);
+    uploadHeights({0, 0, fieldSize, fieldSize});
+    glGenTextures(1, &heightTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, heightTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, vbo);
+#else
+    std::vector<Vertex> vertices(getSize());
+    terrainMesh::buildVertices(heightField, TEX_SCALE, vertices.data(), minY, maxY);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
     // Position
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
     glEnableVertexAttribArray(0);
@@ -187,11 +208,57 @@ void Terrain::buildBuffers() {
     // UV
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)(sizeof(Vertex::position) + sizeof(Vertex::normal)));
     glEnableVertexAttribArray(2);
+#endif
+
+    auto extent = static_cast<float>(size - 1);
+    localBounds = {glm::vec3(0.f, minY, 0.f), glm::vec3(extent, maxY, extent)};
+    buildIndices();
+}
+
+void Terrain::uploadHeights(const DirtyRect &rect) {
+    int fieldSize = size;
+    int width = rect.x1 - rect.x0;
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+    if (heightField.getLayout() == HeightLayout::RowMajor) {
+        if (width == fieldSize) {
+            glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(fieldSize) * rect.y0 * sizeof(float),
+                            static_cast<size_t>(fieldSize) * (rect.y1 - rect.y0) * sizeof(float),
+                            heightField.row(rect.y0));
+            return;
+        }
+        for (int y = rect.y0; y < rect.y1; ++y) {
+            glBufferSubData(GL_ARRAY_BUFFER, (static_cast<GLintptr>(fieldSize) * y + rect.x0) * sizeof(float),
+                            width * sizeof(float), heightField.row(y) + rect.x0);
+        }
+        return;
+    }
+
+    // Tiled fields get copied out a row at a time
+    std::vector<float> row(width);
+    for (int y = rect.y0; y < rect.y1; ++y) {
+        for (int x = rect.x0; x < rect.x1; ++x) {
+            row[x - rect.x0] = heightField.at(x, y);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, (static_cast<GLintptr>(fieldSize) * y + rect.x0) * sizeof(float),
+                        width * sizeof(float), row.data());
+    }
+}
+
+void Terrain::buildIndices() {
+    // The element array binding belongs to the bound VAO, so a buffer uploaded on a cache miss mustn't land on another
+    // terrain's
+    glBindVertexArray(vao);
+    indexBuffer = IndexBufferCache::global().acquire({size, indexMode, indexOrder});
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer->ibo);
+}
 
-    // Indices data
-    glGenBuffers(1, &ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), &indices[0], GL_STATIC_DRAW);
+void Terrain::setIndexOrder(IndexOrder indexOrder) {
+    Terrain::indexOrder = indexOrder;
+    // Acquire the new order first, so a buffer other terrains might want isn't deleted and uploaded again
+    auto previous = indexBuffer;
+    buildIndices();
+    IndexBufferCache::global().release(previous);
 }
 
 unsigned int Terrain::getSize() {
@@ -203,86 +270,21 @@ void Terrain::updateModelMatrix() {
     modelMatrix = glm::rotate(modelMatrix, rotation.x, glm::vec3(1.f, 0.f, 0.f));
     modelMatrix = glm::rotate(modelMatrix, rotation.y, glm::vec3(0.f, 1.f, 0.f));
     modelMatrix = glm::rotate(modelMatrix, rotation.z, glm::vec3(0.f, 0.f, 1.f));
-    // modelMatrix = glm::scale(modelMatrix, scale);
+    modelMatrix = glm::scale(modelMatrix, scale);
 }
 
-float Terrain::diamondStep(int x, int y, int stepSize) {
-    float averagesize = 0.f;
-    int xMin = x - stepSize;
-    int xMax = x + stepSize;
-    int yMin = y - stepSize;
-    int yMax = y + stepSize;
-    averagesize += getValue(xMin, yMin).position.y; // Top left
-    averagesize += getValue(xMin, yMax).position.y; // Bottom left
-    averagesize += getValue(xMax, yMin).position.y; // Top right
-    averagesize += getValue(xMax, yMax).position.y; // Bottom right
-    return averagesize / 4.f;
-}
-
-/**
- * Calculates the average size for the provided vertex based on a diamond pattern around it
- * @param vertices
- * @param x
- * @param y
- * @param stepSize
- */
-float Terrain::squareStep(int x, int y, int stepSize) {
-    float averagesize = 0.f;
-    int xMin = x - stepSize;
-    int xMax = x + stepSize;
-    int yMin = y - stepSize;
-    int yMax = y + stepSize;
-    if (xMin < 0) {
-        xMin = size - abs(xMin);
-    }
-    averagesize += getValue(xMin, y).position.y; // Left
-    if (xMax >= size) {
-        xMax = xMax - size;
-    }
-    averagesize += getValue(xMax, y).position.y; // Right
-    if (yMin < 0) {
-        yMin = size - abs(yMin);
-    }
-    averagesize += getValue(x, yMin).position.y; // Top
-    if (yMax >= size) {
-        yMax = yMax - size;
-    }
-    averagesize += getValue(x, yMax).position.y; // Bottom
-    return averagesize / 4.f;
+void Terrain::setPosition(const glm::vec3 &position) {
+    Terrain::position = position;
+    updateModelMatrix();
 }
 
-/**
- * Applies the Diamond-Square algorithm to the provided set of vertices in a recursive way
- * @param mesh The mesh data
- * @param h The smoothness
- * @param stepSize The step size
- * @param randMax Maximum random offset
- */
-void Terrain::diamondSquare(int stepSize, float randMax) {
-    if (stepSize <= 1) return;
-    int halfStepSize = stepSize / 2;
-    std::uniform_real_distribution<float> distribution(-randMax, randMax);
-
-    for (int x = halfStepSize; x < size - 1; x += stepSize) {
-        for (int y = halfStepSize; y < size - 1; y += stepSize) {
-            getValue(x, y).position.y = diamondStep(x, y, halfStepSize) + distribution(generator);
-        }
-    }
-
-    bool offset = false;
-    for (int x = 0; x <= size - 1; x += halfStepSize) {
-        offset = !offset;
-        for (int y = offset ? halfStepSize : 0; y <= size - 1; y += stepSize) {
-            getValue(x, y).position.y = squareStep(x, y, halfStepSize) + distribution(generator);
-        }
-    }
-
-    randMax = randMax * powf(2, -h);
-    stepSize = halfStepSize;
-    diamondSquare(stepSize, randMax);
+void Terrain::setScale(const glm::vec3 &scale) {
+    Terrain::scale = scale;
+    updateModelMatrix();
 }
 
-void Terrain::setPosition(const glm::vec3 &position) {
-    Terrain::position = position;
-    updateModelMatrix();
+void Terrain::setHeightRange(float minY, float maxY) {
+    Terrain::minY = minY;
+    Terrain::maxY = maxY;
+    heightRangeSet = true;
 }
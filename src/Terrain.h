@@ -5,8 +5,24 @@
 
 #include <vec3.hpp>
 #include <vector>
-#include <random>
+#include "Brush.h"
+#include "Frustum.h"
+#include "HeightField.h"
+#include "HeightGenerator.h"
+#include "IndexBufferCache.h"
 #include "Shader.h"
+#include "TerrainMesh.h"
+
+// Prepended to the terrain and water shaders so they read the same vertex format the terrain was built with
+#if defined(COMPACT_VERTICES) && defined(HEIGHT_ONLY_VERTICES)
+#error "Pick one of COMPACT_VERTICES and HEIGHT_ONLY_VERTICES"
+#elif defined(COMPACT_VERTICES)
+#define TERRAIN_SHADER_DEFINES "#define COMPACT_VERTICES\n"
+#elif defined(HEIGHT_ONLY_VERTICES)
+#define TERRAIN_SHADER_DEFINES "#define HEIGHT_ONLY_VERTICES\n"
+#else
+#define TERRAIN_SHADER_DEFINES ""
+#endif
 
 struct Material {
     glm::vec3 diffuse;
@@ -15,25 +31,19 @@ struct Material {
     std::vector<GLuint> textures;
 };
 
-struct Vertex {
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 uv;
-};
-
 /**
- * Effectively a 1D array that is accessible as a 2D one. Good for quickly uploaded data to OpenGL
+ * A renderable height field. Vertex data is only assembled from the heights when uploading to OpenGL
  */
 class Terrain {
 private:
-    static std::default_random_engine generator;
-
     GLuint vao; // Vertex array
     GLuint vbo; // Vertices data
-    GLuint ibo; // Indices data
-    GLenum mode;
+    GLuint heightTexture; // Buffer texture over the vbo, height only vertices
     Material material;
-    std::vector<unsigned short> indices;
+    IndexMode indexMode;
+    IndexOrder indexOrder = IndexOrder::RowStrips;
+    // Indices are the same for every terrain of this size, so they come from the shared cache
+    const SharedIndexBuffer *indexBuffer = nullptr;
 
     // World space data
     glm::vec3 position;
@@ -41,31 +51,73 @@ private:
     glm::vec3 scale;
     glm::mat4 modelMatrix;
 
-    // Data for generating terrain
+    // Terrain data
     unsigned short size;
     float minY, maxY;
-    float maxRand, h;
-    Vertex *data;
+    bool heightRangeSet = false; // Whether minY/maxY came from setHeightRange, edits then leave them alone
+    float quantMinY, quantMaxY; // Range heights are quantised over in the compact vertex format
+    // Bounds before the model matrix. Kept apart from minY/maxY as those can be overridden for texturing
+    BoundingBox localBounds;
+    HeightField heightField;
+    // Samples edited since the last upload
+    DirtyRect dirty{0, 0, 0, 0};
 
-    float diamondStep(int x, int y, int stepSize);
+    /**
+     * Gets the index buffer for the chosen index mode and order and binds it to the vertex array
+     */
+    void buildIndices();
 
-    float squareStep(int x, int y, int stepSize);
+    /**
+     * Rebuilds the vertices around the dirty rect and uploads just those
+     */
+    void uploadDirty();
 
-    void diamondSquare(int stepSize, float randMax);
+    /**
+     * Copies heights straight into the vbo, height only vertices
+     */
+    void uploadHeights(const DirtyRect &rect);
 
 protected:
     Shader *shader;
 public:
-    Terrain(unsigned short size, float maxRand, float h, Shader *shader, Material &material);
+    /**
+     * Creates a terrain at the world origin, filled by the generator
+     */
+    Terrain(unsigned short size, const HeightGenerator &generator, Shader *shader, Material &material,
+            HeightLayout layout = HeightLayout::RowMajor, IndexMode indexMode = IndexMode::Meshlets);
 
-    Vertex &getValue(int x, int y);
+    /**
+     * Creates a terrain from heights that have already been generated, e.g. on another thread
+     */
+    Terrain(HeightField heightField, Shader *shader, Material &material, IndexMode indexMode = IndexMode::Meshlets);
 
-    Vertex *getData();
+    virtual ~Terrain();
+
+    float &getHeight(int x, int y);
+
+    HeightField &getHeightField();
 
     unsigned int getSize();
 
     /**
-     * Renders the current mesh
+     * Edits the heights with a brush. The mesh is updated on the next render
+     * @param x Brush centre in samples
+     * @param z Brush centre in samples
+     */
+    void applyBrush(const Brush &brush, float x, float z);
+
+    /**
+     * Marks heights as changed after editing them through getHeight/getHeightField, so the next render uploads them
+     */
+    void markDirty(const DirtyRect &rect);
+
+    /**
+     * @return World space bounds of the heights. Grows with edits but never shrinks
+     */
+    virtual BoundingBox getBounds() const;
+
+    /**
+     * Renders the current mesh, uploading any edits first
      */
     virtual void render();
 
@@ -73,7 +125,6 @@ public:
      * Generates the buffers and fills them with the mesh data
      */
     void buildBuffers();
-
     /**
      * Updates the model matrix.
      * This should ALWAYS be called after updating position/rotation/scale
@@ -81,6 +132,23 @@ public:
     void updateModelMatrix();
 
     void setPosition(const glm::vec3 &position);
+
+    /**
+     * Stretches the terrain, e.g. so a coarse version of a map covers the same ground as the full one
+     */
+    void setScale(const glm::vec3 &scale);
+
+    /**
+     * Rebuilds the index buffer in another order. The cache optimised orders draw triangle lists, which take about
+     * three times the indices of the strips but run the vertex shader about half as often.
+     * Forsyth's reorder is slow on large terrains in the Wide index mode, it's quick with meshlets as they share indices
+     */
+    void setIndexOrder(IndexOrder indexOrder);
+
+    /**
+     * Overrides the height range used for texturing, so neighbouring terrains can share one. Edits no longer widen it
+     */
+    void setHeightRange(float minY, float maxY);
 };
 
 
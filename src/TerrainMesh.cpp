@@ -0,0 +1,167 @@
+
+#include <algorithm>
+#include <cmath>
+#include <glm.hpp>
+#include <vector>
+#include "TerrainMesh.h"
+#include "ThreadPool.h"
+
+// Rows handed to a thread at a time
+#define MESH_BLOCK_ROWS 32
+
+namespace {
+    /*
+     * For a quad with heights h00 (x, y), h10 (x+1, y), h01 (x, y+1) and h11 (x+1, y+1) the two triangles have face
+     * normals (h00 - h10, 1, h00 - h01) and (h01 - h11, 1, h10 - h11), scaled by twice their area
+     */
+
+    /**
+     * Sums the face normals around a vertex, skipping triangles that fall outside the field. Used for the edges
+     */
+    glm::vec3 edgeNormal(const HeightField &field, int x, int y) {
+        int last = static_cast<int>(field.getSize()) - 1;
+        auto first = [&](int qx, int qy) {
+            float h00 = field.at(qx, qy);
+            return glm::vec3(h00 - field.at(qx + 1, qy), 1.f, h00 - field.at(qx, qy + 1));
+        };
+        auto second = [&](int qx, int qy) {
+            float h11 = field.at(qx + 1, qy + 1);
+            return glm::vec3(field.at(qx, qy + 1) - h11, 1.f, field.at(qx + 1, qy) - h11);
+        };
+
+        glm::vec3 normal(0.f);
+        if (y > 0) {
+            // Top left quad, second triangle
+            if (x > 0) {
+                normal += second(x - 1, y - 1);
+            }
+            // Top right quad, both triangles
+            if (x < last) {
+                normal += first(x, y - 1);
+                normal += second(x, y - 1);
+            }
+        }
+        if (y < last) {
+            // Bottom left quad, both triangles
+            if (x > 0) {
+                normal += first(x - 1, y);
+                normal += second(x - 1, y);
+            }
+            // Bottom right quad, first triangle
+            if (x < last) {
+                normal += first(x, y);
+            }
+        }
+        return glm::normalize(normal);
+    }
+
+    /**
+     * Row major fields can hand out rows directly, tiled ones get columns [x0, x1) copied into a scratch row
+     */
+    const float *fetchRow(const HeightField &field, int y, int x0, int x1, std::vector<float> &scratch) {
+        if (field.getLayout() == HeightLayout::RowMajor) {
+            return field.row(y);
+        }
+        scratch.resize(field.getSize());
+        for (int x = x0; x < x1; ++x) {
+            scratch[x] = field.at(x, y);
+        }
+        return scratch.data();
+    }
+
+    /**
+     * Builds the vertices for columns [x0, x1) of rows [y0, y1), writing each row of the rect stride vertices apart
+     */
+    void buildRect(const HeightField &field, float texScale, int x0, int y0, int x1, int y1, Vertex *vertices,
+                   size_t stride, float &low, float &high) {
+        int size = static_cast<int>(field.getSize());
+        int last = size - 1;
+        float uvStep = static_cast<float>(size) * texScale / static_cast<float>(last);
+        // Columns the normals read from
+        int readBegin = std::max(x0 - 1, 0);
+        int readEnd = std::min(x1 + 1, size);
+        std::vector<float> scratch[3];
+        low = field.at(x0, y0);
+        high = low;
+
+        for (int y = y0; y < y1; ++y) {
+            const float *centre = fetchRow(field, y, readBegin, readEnd, scratch[0]);
+            Vertex *out = vertices + stride * (y - y0) - x0;
+            float v = static_cast<float>(y) * uvStep;
+
+            for (int x = x0; x < x1; ++x) {
+                float height = centre[x];
+                low = std::min(low, height);
+                high = std::max(high, height);
+                out[x].position = glm::vec3(static_cast<float>(x), height, static_cast<float>(y));
+                out[x].uv = glm::vec2(static_cast<float>(x) * uvStep, v);
+            }
+
+            if (y == 0 || y == last) {
+                for (int x = x0; x < x1; ++x) {
+                    out[x].normal = edgeNormal(field, x, y);
+                }
+                continue;
+            }
+
+            // Interior vertices touch six triangles, which sum to
+            // (2W - 2E + N - NE + SW - S, 6, 2N - 2S + NE - E + W - SW)
+            const float *north = fetchRow(field, y - 1, readBegin, readEnd, scratch[1]);
+            const float *south = fetchRow(field, y + 1, readBegin, readEnd, scratch[2]);
+            int xBegin = std::max(x0, 1);
+            int xEnd = std::min(x1, last);
+            if (x0 == 0) {
+                out[0].normal = edgeNormal(field, 0, y);
+            }
+            for (int x = xBegin; x < xEnd; ++x) {
+                float sx = 2.f * (centre[x - 1] - centre[x + 1]) + north[x] - north[x + 1] + south[x - 1] - south[x];
+                float sz = 2.f * (north[x] - south[x]) + north[x + 1] - centre[x + 1] + centre[x - 1] - south[x - 1];
+                float length = std::sqrt(sx * sx + 36.f + sz * sz);
+                out[x].normal = glm::vec3(sx, 6.f, sz) / length;
+            }
+            if (x1 == size) {
+                out[last].normal = edgeNormal(field, last, y);
+            }
+        }
+    }
+}
+
+void terrainMesh::buildVertices(const HeightField &field, float texScale, Vertex *vertices, float &minY,
+                                float &maxY) {
+    int size = static_cast<int>(field.getSize());
+    int blocks = (size + MESH_BLOCK_ROWS - 1) / MESH_BLOCK_ROWS;
+    std::vector<float> blockMin(blocks), blockMax(blocks);
+
+    ThreadPool::global().parallelFor(0, blocks, [&](int block) {
+        int yBegin = block * MESH_BLOCK_ROWS;
+        int yEnd = std::min(yBegin + MESH_BLOCK_ROWS, size);
+        buildRect(field, texScale, 0, yBegin, size, yEnd, vertices + static_cast<size_t>(size) * yBegin, size,
+                  blockMin[block], blockMax[block]);
+    });
+
+    minY = *std::min_element(blockMin.begin(), blockMin.end());
+    maxY = *std::max_element(blockMax.begin(), blockMax.end());
+}
+
+void terrainMesh::buildVertices(const HeightField &field, float texScale, const DirtyRect &rect, Vertex *vertices,
+                                float &minY, float &maxY) {
+    buildRect(field, texScale, rect.x0, rect.y0, rect.x1, rect.y1, vertices, rect.x1 - rect.x0, minY, maxY);
+}
+
+void terrainMesh::buildCompactVertices(const HeightField &field, const DirtyRect &rect, float minY, float maxY,
+                                       CompactVertex *vertices) {
+    int width = rect.x1 - rect.x0;
+    int blocks = (rect.y1 - rect.y0 + MESH_BLOCK_ROWS - 1) / MESH_BLOCK_ROWS;
+
+    // Full vertices only ever exist a block at a time. The UVs are thrown away so the texture scale doesn't matter
+    ThreadPool::global().parallelFor(0, blocks, [&](int block) {
+        int yBegin = rect.y0 + block * MESH_BLOCK_ROWS;
+        int yEnd = std::min(yBegin + MESH_BLOCK_ROWS, rect.y1);
+        size_t count = static_cast<size_t>(width) * (yEnd - yBegin);
+        std::vector<Vertex> scratch(count);
+        float low, high;
+        buildRect(field, 1.f, rect.x0, yBegin, rect.x1, yEnd, scratch.data(), width, low, high);
+        packVertices(scratch.data(), count, minY, maxY,
+                     vertices + static_cast<size_t>(width) * (yBegin - rect.y0));
+    });
+}
@@ -0,0 +1,109 @@
+
+#ifndef PROCGEN_TERRAINMESH_H
+#define PROCGEN_TERRAINMESH_H
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vec2.hpp>
+#include <vec3.hpp>
+#include "Brush.h"
+#include "HeightField.h"
+
+// Bits per normal component in the compact vertex format, 8 or 16
+#ifndef COMPACT_NORMAL_BITS
+#define COMPACT_NORMAL_BITS 8
+#endif
+
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+/**
+ * Quantised terrain vertex. x, z and the UVs are worked out in the vertex shader from gl_VertexID and the grid size.
+ * 4 bytes with 8 bit normals, 8 with 16 bit ones
+ * @tparam N Normal component type, signed char or short
+ */
+template<typename N>
+struct alignas(4) PackedVertex {
+    unsigned short height; // 0 to 65535 over the terrain's quantisation range
+    N normal[2]; // Octahedral encoded, the y axis is the one that gets folded
+};
+
+#if COMPACT_NORMAL_BITS == 16
+typedef PackedVertex<short> CompactVertex;
+#else
+typedef PackedVertex<signed char> CompactVertex;
+#endif
+
+/**
+ * Turns a height field into vertex data without needing OpenGL
+ */
+namespace terrainMesh {
+    /**
+     * Fills in positions, normals and UVs for every sample and finds the height range, in one pass split across the
+     * thread pool by blocks of rows.
+     * Normals are the sum of the face normals of the triangles around each vertex (so weighted by triangle area), worked
+     * out straight from the heights. Triangles follow the strip order used for drawing, which splits each quad along
+     * the diagonal from (x, y + 1) to (x + 1, y)
+     * @param field The heights
+     * @param texScale How many times the textures repeat per sample
+     * @param vertices Output, size * size vertices in row major order
+     * @param minY Lowest height
+     * @param maxY Highest height
+     */
+    void buildVertices(const HeightField &field, float texScale, Vertex *vertices, float &minY, float &maxY);
+
+    /**
+     * Builds the vertices for just part of the field, on the calling thread. Normals depend on the neighbouring
+     * samples, so after editing heights the rect should be expanded by one sample
+     * @param rect The part of the field to build
+     * @param vertices Output, the vertices of the rect in row major order
+     * @param minY Lowest height within the rect
+     * @param maxY Highest height within the rect
+     */
+    void buildVertices(const HeightField &field, float texScale, const DirtyRect &rect, Vertex *vertices, float &minY,
+                       float &maxY);
+
+    /**
+     * Builds compact vertices for part of the field, split across the thread pool by blocks of rows
+     * @param rect The part of the field to build
+     * @param minY Bottom of the quantisation range, heights outside the range are clamped
+     * @param maxY Top of the quantisation range
+     * @param vertices Output, the vertices of the rect in row major order
+     */
+    void buildCompactVertices(const HeightField &field, const DirtyRect &rect, float minY, float maxY,
+                              CompactVertex *vertices);
+
+    /**
+     * Quantises full vertices into the packed format
+     */
+    template<typename N>
+    void packVertices(const Vertex *vertices, size_t count, float minY, float maxY, PackedVertex<N> *out) {
+        const float normalMax = static_cast<float>((1 << (sizeof(N) * 8 - 1)) - 1);
+        float heightScale = maxY > minY ? 65535.f / (maxY - minY) : 0.f;
+        for (size_t i = 0; i < count; ++i) {
+            float height = (vertices[i].position.y - minY) * heightScale + .5f;
+            out[i].height = static_cast<unsigned short>(std::min(std::max(height, 0.f), 65535.f));
+
+            // Project onto the octahedron, then fold the lower half over the upper one
+            const glm::vec3 &normal = vertices[i].normal;
+            float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+            float u = normal.x / sum;
+            float v = normal.z / sum;
+            if (normal.y < 0.f) {
+                float foldedU = (1.f - std::abs(v)) * (u >= 0.f ? 1.f : -1.f);
+                v = (1.f - std::abs(u)) * (v >= 0.f ? 1.f : -1.f);
+                u = foldedU;
+            }
+            out[i].normal[0] = static_cast<N>(std::round(u * normalMax));
+            out[i].normal[1] = static_cast<N>(std::round(v * normalMax));
+        }
+    }
+}
+
+
+#endif //PROCGEN_TERRAINMESH_H
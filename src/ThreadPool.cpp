@@ -0,0 +1,114 @@
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    // Caller thread counts as one of the threads
+    for (unsigned int i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    if (workers.empty()) {
+        task();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    condition.notify_one();
+}
+
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int)> &func) {
+    if (end <= begin) return;
+    if (getThreadCount() == 1 || end - begin == 1) {
+        for (int i = begin; i < end; ++i) {
+            func(i);
+        }
+        return;
+    }
+
+    // Shared between the caller and any helpers. Helpers that start after every index has been claimed just return
+    struct Job {
+        std::atomic<int> next;
+        std::atomic<int> remaining;
+        int end;
+        const std::function<void(int)> *func;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto job = std::make_shared<Job>();
+    job->next = begin;
+    job->remaining = end - begin;
+    job->end = end;
+    job->func = &func;
+
+    auto run = [](Job &job) {
+        int i;
+        while ((i = job.next.fetch_add(1)) < job.end) {
+            (*job.func)(i);
+            if (job.remaining.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(job.mutex);
+                job.done.notify_all();
+            }
+        }
+    };
+
+    auto helpers = std::min(static_cast<int>(getThreadCount()) - 1, end - begin - 1);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = 0; i < helpers; ++i) {
+            tasks.push_back([job, run] { run(*job); });
+        }
+    }
+    condition.notify_all();
+
+    run(*job);
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->done.wait(lock, [&job] { return job->remaining == 0; });
+}
+
+unsigned int ThreadPool::getThreadCount() const {
+    auto threads = static_cast<unsigned int>(workers.size()) + 1;
+    unsigned int limit = threadLimit;
+    return limit > 0 ? std::min(threads, limit) : threads;
+}
+
+void ThreadPool::setThreadLimit(unsigned int threads) {
+    threadLimit = threads;
+}
+
+ThreadPool &ThreadPool::global() {
+    static ThreadPool pool;
+    return pool;
+}
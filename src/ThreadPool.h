@@ -0,0 +1,72 @@
+
+#ifndef PROCGEN_THREADPOOL_H
+#define PROCGEN_THREADPOOL_H
+
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of worker threads used to split generation work up across all cores.
+ * The calling thread always takes part in parallelFor so it is safe to use from inside a submitted task.
+ */
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+    std::atomic<unsigned int> threadLimit{0};
+
+    void workerLoop();
+
+public:
+    /**
+     * @param threadCount Total number of threads that work on a parallelFor, including the caller.
+     *                    A value of 1 runs everything on the calling thread
+     */
+    explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * Queues a task to be run on a worker thread at some point in the future
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * Calls func for every index in [begin, end) spread across the pool and blocks until all of them have finished.
+     * Acts as a barrier, so consecutive calls never overlap
+     */
+    void parallelFor(int begin, int end, const std::function<void(int)> &func);
+
+    /**
+     * @return Threads that work on a parallelFor, including the caller
+     */
+    unsigned int getThreadCount() const;
+
+    /**
+     * Caps how many threads work on each parallelFor, including the caller, e.g. to measure how work scales. Submitted
+     * tasks still run on any worker
+     * @param threads 0 to use every thread again
+     */
+    void setThreadLimit(unsigned int threads);
+
+    /**
+     * The shared pool used by generation code, sized to the number of hardware threads
+     */
+    static ThreadPool &global();
+};
+
+
+#endif //PROCGEN_THREADPOOL_H
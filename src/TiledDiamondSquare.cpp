@@ -0,0 +1,112 @@
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "TiledDiamondSquare.h"
+
+namespace {
+    /**
+     * Cell sizes have to be a power of two no bigger than the world, anything else falls back to one cell
+     */
+    int checkCellSize(unsigned int size, unsigned int cellSize) {
+        if (cellSize < 2 || (cellSize & (cellSize - 1)) != 0 || cellSize > size - 1) {
+            std::cerr << "Diamond-square cells need to be a power of two up to " << size - 1 << ", not " << cellSize
+                      << std::endl;
+            return static_cast<int>(size - 1);
+        }
+        return static_cast<int>(cellSize);
+    }
+}
+
+TiledDiamondSquare::TiledDiamondSquare(std::shared_ptr<const DiamondSquare> diamondSquare, unsigned int size,
+                                       unsigned int cellSize)
+        : diamondSquare(std::move(diamondSquare)), size(static_cast<int>(size)),
+          cellSize(checkCellSize(size, cellSize)), grid((size - 1) / TiledDiamondSquare::cellSize + 1) {
+    cellRandMax = TiledDiamondSquare::diamondSquare->generateGrid(grid, TiledDiamondSquare::cellSize);
+
+    // Every refined sample is an average of samples already set plus an offset, so it can't stray further from the
+    // grid than all the offsets still to come added up
+    float offsets = 0.f;
+    float randMax = cellRandMax;
+    for (int stepSize = TiledDiamondSquare::cellSize; stepSize > 1; stepSize /= 2) {
+        offsets += randMax;
+        randMax *= powf(2, -TiledDiamondSquare::diamondSquare->getSmoothness());
+    }
+    auto range = std::minmax_element(grid.getData(), grid.getData() + grid.getDataSize());
+    minHeight = *range.first - offsets;
+    maxHeight = *range.second + offsets;
+}
+
+void TiledDiamondSquare::refineCell(HeightField &cell, int cellX, int cellY) const {
+    cell.at(0, 0) = grid.at(cellX, cellY);
+    cell.at(cellSize, 0) = grid.at(cellX + 1, cellY);
+    cell.at(0, cellSize) = grid.at(cellX, cellY + 1);
+    cell.at(cellSize, cellSize) = grid.at(cellX + 1, cellY + 1);
+    diamondSquare->refine(cell, cellRandMax, cellX * cellSize, cellY * cellSize);
+}
+
+void TiledDiamondSquare::generate(HeightField &field, int originX, int originY) const {
+    int fieldSize = field.getSize();
+    if (fieldSize - 1 == cellSize && originX % cellSize == 0 && originY % cellSize == 0 && originX >= 0 &&
+        originY >= 0 && originX < size - 1 && originY < size - 1) {
+        refineCell(field, originX / cellSize, originY / cellSize);
+        return;
+    }
+
+    // Which cell each row and column comes from and where in it. Samples on the edge between two cells are the same
+    // in both, so the last sample of the world counts as part of the last cell
+    int cells = grid.getSize() - 1;
+    std::vector<int> columnCells(fieldSize), columnSamples(fieldSize), rowCells(fieldSize), rowSamples(fieldSize);
+    for (int i = 0; i < fieldSize; ++i) {
+        int x = std::min(std::max(originX + i, 0), size - 1);
+        int y = std::min(std::max(originY + i, 0), size - 1);
+        columnCells[i] = std::min(x / cellSize, cells - 1);
+        columnSamples[i] = x - columnCells[i] * cellSize;
+        rowCells[i] = std::min(y / cellSize, cells - 1);
+        rowSamples[i] = y - rowCells[i] * cellSize;
+    }
+
+    // Both go up with i, so every cell covers one block of rows and columns
+    HeightField cell(cellSize + 1);
+    for (int cellY = rowCells.front(); cellY <= rowCells.back(); ++cellY) {
+        auto rows = std::equal_range(rowCells.begin(), rowCells.end(), cellY);
+        for (int cellX = columnCells.front(); cellX <= columnCells.back(); ++cellX) {
+            auto columns = std::equal_range(columnCells.begin(), columnCells.end(), cellX);
+            refineCell(cell, cellX, cellY);
+            for (auto row = rows.first; row != rows.second; ++row) {
+                int y = static_cast<int>(row - rowCells.begin());
+                for (auto column = columns.first; column != columns.second; ++column) {
+                    int x = static_cast<int>(column - columnCells.begin());
+                    field.at(x, y) = cell.at(columnSamples[x], rowSamples[y]);
+                }
+            }
+        }
+    }
+}
+
+float TiledDiamondSquare::getHeightScale() const {
+    return diamondSquare->getHeightScale();
+}
+
+void TiledDiamondSquare::hash(Hasher &hasher) const {
+    hasher.add("TiledDiamondSquare");
+    diamondSquare->hash(hasher);
+    hasher.add(size).add(cellSize);
+}
+
+unsigned int TiledDiamondSquare::getSize() const {
+    return static_cast<unsigned int>(size);
+}
+
+unsigned int TiledDiamondSquare::getCellSize() const {
+    return static_cast<unsigned int>(cellSize);
+}
+
+float TiledDiamondSquare::getMinHeight() const {
+    return minHeight;
+}
+
+float TiledDiamondSquare::getMaxHeight() const {
+    return maxHeight;
+}
@@ -0,0 +1,67 @@
+
+#ifndef PROCGEN_TILEDDIAMONDSQUARE_H
+#define PROCGEN_TILEDDIAMONDSQUARE_H
+
+
+#include <memory>
+#include "DiamondSquare.h"
+
+/**
+ * Diamond-square over a world too big to hold in memory, e.g. 65537 x 65537, meant to be written out a tile at a time
+ * with TiledHeightmap::create and read back from the file.
+ *
+ * The first levels only touch every cellSize-th sample, so they run up front on a small grid of those samples and give
+ * the whole world its large scale shape. Every cell of the grid is then refined on its own from its four corners, with
+ * seamless edges so neighbouring cells agree on the samples they share. A cell only needs its corners, so cells can be
+ * generated in any order, on any thread, and memory only depends on the cell size.
+ *
+ * Cells are cut on a grid of their own, so unlike plain seamless diamond-square the shape carries on across them
+ */
+class TiledDiamondSquare : public HeightGenerator {
+private:
+    std::shared_ptr<const DiamondSquare> diamondSquare;
+    int size, cellSize;
+    HeightField grid;
+    float cellRandMax;
+    float minHeight, maxHeight;
+
+    /**
+     * Fills a cellSize + 1 field with one cell of the world
+     */
+    void refineCell(HeightField &cell, int cellX, int cellY) const;
+
+public:
+    /**
+     * @param size Samples along one side of the world, 2^n+1
+     * @param cellSize Samples along one side of a cell, a power of two up to size - 1. Matching the tile size of the
+     *                 heightmap it's written to means every tile is exactly one cell
+     */
+    TiledDiamondSquare(std::shared_ptr<const DiamondSquare> diamondSquare, unsigned int size, unsigned int cellSize);
+
+    /**
+     * Fills the field with the world from the origin, clamped to its edges. A field exactly one cell in size and lined
+     * up with the cells is refined in place, anything else refines every cell it overlaps and copies from them
+     */
+    void generate(HeightField &field, int originX = 0, int originY = 0) const override;
+
+    float getHeightScale() const override;
+
+    void hash(Hasher &hasher) const override;
+
+    unsigned int getSize() const;
+
+    unsigned int getCellSize() const;
+
+    /**
+     * No sample in the world is lower than this, e.g. to pick the range a heightmap is stored over
+     */
+    float getMinHeight() const;
+
+    /**
+     * No sample in the world is higher than this
+     */
+    float getMaxHeight() const;
+};
+
+
+#endif //PROCGEN_TILEDDIAMONDSQUARE_H
@@ -0,0 +1,385 @@
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "TiledHeightmap.h"
+#include "ThreadPool.h"
+
+namespace {
+    const char heightmapMagic[4] = {'P', 'G', 'T', 'M'};
+
+    size_t alignUp(size_t offset) {
+        return (offset + TILED_HEIGHTMAP_ALIGNMENT - 1) / TILED_HEIGHTMAP_ALIGNMENT * TILED_HEIGHTMAP_ALIGNMENT;
+    }
+
+    bool isPowerOfTwo(unsigned int value) {
+        return value && (value & (value - 1)) == 0;
+    }
+
+    uint16_t quantise(float height, float minY, float maxY) {
+        float scaled = (height - minY) / (maxY - minY) * 65535.f + .5f;
+        return static_cast<uint16_t>(std::min(std::max(scaled, 0.f), 65535.f));
+    }
+}
+
+void TiledHeightmap::layout(const Header &header, std::vector<unsigned int> &levelSizes,
+                            std::vector<unsigned int> &levelTiles, std::vector<size_t> &levelFirstTile) {
+    size_t tiles = 0;
+    for (unsigned int level = 0; level < header.levels; ++level) {
+        unsigned int size = (header.size - 1) / (1u << level) + 1;
+        unsigned int sideTiles = (size + header.tileSize - 1) / header.tileSize;
+        levelSizes.push_back(size);
+        levelTiles.push_back(sideTiles);
+        levelFirstTile.push_back(tiles);
+        tiles += static_cast<size_t>(sideTiles) * sideTiles;
+    }
+    levelFirstTile.push_back(tiles);
+}
+
+TiledHeightmap::TiledHeightmap(const std::string &path) : file(path), path(path) {
+    if (!file.isOpen()) {
+        std::cerr << "Failed to open heightmap " << path << std::endl;
+        return;
+    }
+    if (file.getSize() >= sizeof(Header)) {
+        memcpy(&header, file.getData(), sizeof(Header));
+    }
+    if (memcmp(header.magic, heightmapMagic, sizeof(heightmapMagic)) != 0 ||
+        header.version != TILED_HEIGHTMAP_VERSION || !isPowerOfTwo(header.tileSize) || header.tileSize < 64 ||
+        header.size < 2 || header.levels < 1 || header.levels > 32 || header.indexOffset % sizeof(uint64_t) != 0) {
+        std::cerr << path << " isn't a version " << TILED_HEIGHTMAP_VERSION << " tiled heightmap" << std::endl;
+        return;
+    }
+
+    layout(header, levelSizes, levelTiles, levelFirstTile);
+    size_t tiles = levelFirstTile.back();
+    if (header.indexOffset + tiles * sizeof(uint64_t) > file.getSize()) {
+        std::cerr << "Heightmap " << path << " is cut short" << std::endl;
+        return;
+    }
+    index = reinterpret_cast<const uint64_t *>(file.getData() + header.indexOffset);
+    for (size_t tile = 0; tile < tiles; ++tile) {
+        if (index[tile] % TILED_HEIGHTMAP_ALIGNMENT != 0 || index[tile] + getTileBytes() > file.getSize()) {
+            std::cerr << "Heightmap " << path << " is cut short" << std::endl;
+            return;
+        }
+    }
+
+    // Access jumps around the file with the camera, reading ahead would only load tiles that aren't needed
+    file.advise(0, file.getSize(), FileAccess::Random);
+    valid = true;
+}
+
+bool TiledHeightmap::isOpen() const {
+    return valid;
+}
+
+const std::string &TiledHeightmap::getPath() const {
+    return path;
+}
+
+unsigned int TiledHeightmap::getSize(int level) const {
+    return levelSizes[level];
+}
+
+unsigned int TiledHeightmap::getLevels() const {
+    return header.levels;
+}
+
+unsigned int TiledHeightmap::getTileSize() const {
+    return header.tileSize;
+}
+
+float TiledHeightmap::getMinY() const {
+    return header.minY;
+}
+
+float TiledHeightmap::getMaxY() const {
+    return header.maxY;
+}
+
+size_t TiledHeightmap::getTileBytes() const {
+    return static_cast<size_t>(header.tileSize) * header.tileSize * sizeof(uint16_t);
+}
+
+size_t TiledHeightmap::getTile(int level, int tileX, int tileY) const {
+    return levelFirstTile[level] + static_cast<size_t>(levelTiles[level]) * tileY + tileX;
+}
+
+const uint16_t *TiledHeightmap::getTileData(size_t tile) const {
+    return reinterpret_cast<const uint16_t *>(file.getData() + index[tile]);
+}
+
+float TiledHeightmap::sample(int level, int x, int y) const {
+    int last = static_cast<int>(levelSizes[level]) - 1;
+    x = std::min(std::max(x, 0), last);
+    y = std::min(std::max(y, 0), last);
+    int tileSize = static_cast<int>(header.tileSize);
+    const uint16_t *tile = getTileData(getTile(level, x / tileSize, y / tileSize));
+    uint16_t value = tile[(y % tileSize) * tileSize + x % tileSize];
+    return header.minY + static_cast<float>(value) * ((header.maxY - header.minY) / 65535.f);
+}
+
+void TiledHeightmap::touch(const std::vector<size_t> &tiles) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t tile : tiles) {
+        auto resident = residentTiles.find(tile);
+        if (resident != residentTiles.end()) {
+            recentTiles.splice(recentTiles.begin(), recentTiles, resident->second);
+        } else {
+            recentTiles.push_front(tile);
+            residentTiles[tile] = recentTiles.begin();
+        }
+    }
+    while (recentTiles.size() > tileBudget) {
+        // Tiles are never written to, so dropped pages are just read from the file again if they're needed later
+        size_t oldest = recentTiles.back();
+        file.advise(index[oldest], getTileBytes(), FileAccess::DontNeed);
+        residentTiles.erase(oldest);
+        recentTiles.pop_back();
+    }
+}
+
+void TiledHeightmap::prefetch(int level, int x0, int y0, int x1, int y1) const {
+    int last = static_cast<int>(levelSizes[level]) - 1;
+    int tileSize = static_cast<int>(header.tileSize);
+    int firstTileX = std::min(std::max(x0, 0), last) / tileSize;
+    int firstTileY = std::min(std::max(y0, 0), last) / tileSize;
+    int lastTileX = std::min(std::max(x1 - 1, 0), last) / tileSize;
+    int lastTileY = std::min(std::max(y1 - 1, 0), last) / tileSize;
+    for (int tileY = firstTileY; tileY <= lastTileY; ++tileY) {
+        for (int tileX = firstTileX; tileX <= lastTileX; ++tileX) {
+            file.advise(index[getTile(level, tileX, tileY)], getTileBytes(), FileAccess::WillNeed);
+        }
+    }
+}
+
+void TiledHeightmap::read(int level, int x, int y, HeightField &field) const {
+    int size = static_cast<int>(field.getSize());
+    int last = static_cast<int>(levelSizes[level]) - 1;
+    int tileSize = static_cast<int>(header.tileSize);
+
+    // Every tile is asked for before any are read, so they load together rather than one page fault at a time
+    prefetch(level, x, y, x + size, y + size);
+    std::vector<size_t> tiles;
+    int firstTileX = std::min(std::max(x, 0), last) / tileSize;
+    int lastTileX = std::min(std::max(x + size - 1, 0), last) / tileSize;
+    int firstTileY = std::min(std::max(y, 0), last) / tileSize;
+    int lastTileY = std::min(std::max(y + size - 1, 0), last) / tileSize;
+    for (int tileY = firstTileY; tileY <= lastTileY; ++tileY) {
+        for (int tileX = firstTileX; tileX <= lastTileX; ++tileX) {
+            tiles.push_back(getTile(level, tileX, tileY));
+        }
+    }
+    touch(tiles);
+
+    float scale = (header.maxY - header.minY) / 65535.f;
+    bool rowMajor = field.getLayout() == HeightLayout::RowMajor;
+    for (int row = 0; row < size; ++row) {
+        int levelY = std::min(std::max(y + row, 0), last);
+        int tileY = levelY / tileSize;
+        size_t rowOffset = static_cast<size_t>(levelY % tileSize) * tileSize;
+        float *out = rowMajor ? field.row(row) : nullptr;
+        int currentTileX = -1;
+        const uint16_t *tileRow = nullptr;
+        for (int column = 0; column < size; ++column) {
+            int levelX = std::min(std::max(x + column, 0), last);
+            if (levelX / tileSize != currentTileX) {
+                currentTileX = levelX / tileSize;
+                tileRow = getTileData(getTile(level, currentTileX, tileY)) + rowOffset;
+            }
+            float height = header.minY + static_cast<float>(tileRow[levelX % tileSize]) * scale;
+            if (rowMajor) {
+                out[column] = height;
+            } else {
+                field.at(column, row) = height;
+            }
+        }
+    }
+}
+
+void TiledHeightmap::setTileBudget(size_t tiles) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tileBudget = tiles;
+}
+
+size_t TiledHeightmap::getResidentTiles() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return recentTiles.size();
+}
+
+bool TiledHeightmap::create(const std::string &path, unsigned int size, unsigned int tileSize, float minY, float maxY,
+                            const TileSource &source) {
+    if (!isPowerOfTwo(tileSize) || tileSize < 64 || size < 2 || maxY <= minY) {
+        std::cerr << "Heightmaps need a power of two tile size of at least 64, at least 2 samples and maxY above minY"
+                  << std::endl;
+        return false;
+    }
+
+    Header header{};
+    memcpy(header.magic, heightmapMagic, sizeof(heightmapMagic));
+    header.version = TILED_HEIGHTMAP_VERSION;
+    header.size = size;
+    header.tileSize = tileSize;
+    header.levels = 1;
+    for (unsigned int levelSize = size; levelSize > tileSize; levelSize = (levelSize - 1) / 2 + 1) {
+        ++header.levels;
+    }
+    header.minY = minY;
+    header.maxY = maxY;
+    header.indexOffset = sizeof(uint64_t) * 8;
+
+    std::vector<unsigned int> levelSizes, levelTiles;
+    std::vector<size_t> levelFirstTile;
+    layout(header, levelSizes, levelTiles, levelFirstTile);
+    size_t tileBytes = static_cast<size_t>(tileSize) * tileSize * sizeof(uint16_t);
+    std::vector<uint64_t> offsets(levelFirstTile.back());
+    size_t firstOffset = alignUp(header.indexOffset + offsets.size() * sizeof(uint64_t));
+    for (size_t tile = 0; tile < offsets.size(); ++tile) {
+        offsets[tile] = firstOffset + tile * tileBytes;
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    std::vector<char> padding(firstOffset, 0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(padding.data(), static_cast<std::streamsize>(header.indexOffset - sizeof(header)));
+    out.write(reinterpret_cast<const char *>(offsets.data()),
+              static_cast<std::streamsize>(offsets.size() * sizeof(uint64_t)));
+    out.write(padding.data(),
+              static_cast<std::streamsize>(firstOffset - header.indexOffset - offsets.size() * sizeof(uint64_t)));
+
+    // Tiles are written in the order they sit in the file, so the whole file is written front to back
+    std::vector<float> samples(static_cast<size_t>(tileSize) * tileSize);
+    std::vector<uint16_t> quantised(samples.size());
+    for (unsigned int tileY = 0; tileY < levelTiles[0]; ++tileY) {
+        for (unsigned int tileX = 0; tileX < levelTiles[0]; ++tileX) {
+            std::fill(samples.begin(), samples.end(), minY);
+            source(static_cast<int>(tileX), static_cast<int>(tileY), samples.data());
+            for (size_t i = 0; i < samples.size(); ++i) {
+                quantised[i] = quantise(samples[i], minY, maxY);
+            }
+            out.write(reinterpret_cast<const char *>(quantised.data()), static_cast<std::streamsize>(tileBytes));
+        }
+    }
+    out.close();
+
+    for (unsigned int level = 1; level < header.levels && out; ++level) {
+        // The level below is complete on disk, read it back through a mapping so it never has to fit in memory
+        MappedFile below(path);
+        if (!below.isOpen()) {
+            return false;
+        }
+        auto belowTile = [&](unsigned int tileX, unsigned int tileY) {
+            size_t tile = levelFirstTile[level - 1] + static_cast<size_t>(levelTiles[level - 1]) * tileY + tileX;
+            return reinterpret_cast<const uint16_t *>(below.getData() + offsets[tile]);
+        };
+
+        out.open(path, std::ios::binary | std::ios::app);
+        for (unsigned int tileY = 0; tileY < levelTiles[level]; ++tileY) {
+            for (unsigned int tileX = 0; tileX < levelTiles[level]; ++tileX) {
+                std::fill(quantised.begin(), quantised.end(), 0);
+                for (unsigned int y = 0; y < tileSize; ++y) {
+                    unsigned int levelY = tileY * tileSize + y;
+                    if (levelY >= levelSizes[level]) {
+                        break;
+                    }
+                    for (unsigned int x = 0; x < tileSize; ++x) {
+                        unsigned int levelX = tileX * tileSize + x;
+                        if (levelX >= levelSizes[level]) {
+                            break;
+                        }
+                        unsigned int belowX = levelX * 2, belowY = levelY * 2;
+                        const uint16_t *tile = belowTile(belowX / tileSize, belowY / tileSize);
+                        quantised[static_cast<size_t>(y) * tileSize + x] =
+                                tile[(belowY % tileSize) * tileSize + belowX % tileSize];
+                    }
+                }
+                out.write(reinterpret_cast<const char *>(quantised.data()), static_cast<std::streamsize>(tileBytes));
+            }
+            // Each row of tiles reads two rows of the level below, which aren't needed again
+            for (unsigned int belowY = tileY * 2; belowY < std::min(tileY * 2 + 2, levelTiles[level - 1]); ++belowY) {
+                size_t first = levelFirstTile[level - 1] + static_cast<size_t>(levelTiles[level - 1]) * belowY;
+                below.advise(offsets[first], tileBytes * levelTiles[level - 1], FileAccess::DontNeed);
+            }
+        }
+        out.close();
+    }
+
+    if (!out) {
+        std::cerr << "Failed to write heightmap " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TiledHeightmap::create(const std::string &path, unsigned int size, unsigned int tileSize, float minY, float maxY,
+                            const HeightGenerator &generator) {
+    // Tiles come in rows, so a whole row is generated in parallel when its first tile is asked for
+    unsigned int sideTiles = (size + tileSize - 1) / tileSize;
+    size_t tileSamples = static_cast<size_t>(tileSize) * tileSize;
+    std::vector<float> row(tileSamples * sideTiles);
+    return create(path, size, tileSize, minY, maxY, [&](int tileX, int tileY, float *samples) {
+        if (tileX == 0) {
+            ThreadPool::global().parallelFor(0, static_cast<int>(sideTiles), [&](int column) {
+                // One more than the tile so it's 2^n+1, the extra row and column belong to the next tiles
+                HeightField field(tileSize + 1);
+                generator.generate(field, column * static_cast<int>(tileSize), tileY * static_cast<int>(tileSize));
+                float *out = &row[tileSamples * column];
+                for (unsigned int y = 0; y < tileSize; ++y) {
+                    std::copy(field.row(static_cast<int>(y)), field.row(static_cast<int>(y)) + tileSize,
+                              out + static_cast<size_t>(y) * tileSize);
+                }
+            });
+        }
+        std::copy(&row[tileSamples * tileX], &row[tileSamples * (tileX + 1)], samples);
+    });
+}
+
+bool TiledHeightmap::importRaw16(const std::string &rawPath, unsigned int size, const std::string &path,
+                                 unsigned int tileSize, float minY, float maxY) {
+    MappedFile raw(rawPath);
+    size_t rowBytes = static_cast<size_t>(size) * sizeof(uint16_t);
+    if (!raw.isOpen() || raw.getSize() != rowBytes * size) {
+        std::cerr << rawPath << " isn't a " << size << "x" << size << " 16 bit heightmap" << std::endl;
+        return false;
+    }
+    raw.advise(0, raw.getSize(), FileAccess::Random);
+
+    unsigned int sideTiles = (size + tileSize - 1) / tileSize;
+    float scale = (maxY - minY) / 65535.f;
+    return create(path, size, tileSize, minY, maxY, [&](int tileX, int tileY, float *samples) {
+        unsigned int x0 = tileX * tileSize, y0 = tileY * tileSize;
+        unsigned int width = std::min(tileSize, size - x0), height = std::min(tileSize, size - y0);
+        for (unsigned int y = 0; y < height; ++y) {
+            const unsigned char *source = raw.getData() + rowBytes * (y0 + y) + x0 * sizeof(uint16_t);
+            for (unsigned int x = 0; x < width; ++x) {
+                unsigned int value = source[x * 2] | source[x * 2 + 1] << 8;
+                samples[static_cast<size_t>(y) * tileSize + x] = minY + static_cast<float>(value) * scale;
+            }
+        }
+        if (tileX == static_cast<int>(sideTiles) - 1) {
+            // Done with these rows, don't let the whole raw file build up in memory
+            raw.advise(rowBytes * y0, rowBytes * height, FileAccess::DontNeed);
+        }
+    });
+}
+
+TiledHeightmapSource::TiledHeightmapSource(std::shared_ptr<const TiledHeightmap> heightmap, int level)
+        : heightmap(std::move(heightmap)), level(level) {}
+
+void TiledHeightmapSource::generate(HeightField &field, int originX, int originY) const {
+    heightmap->read(level, originX, originY, field);
+}
+
+float TiledHeightmapSource::getHeightScale() const {
+    return std::max(std::abs(heightmap->getMinY()), std::abs(heightmap->getMaxY()));
+}
+
+void TiledHeightmapSource::hash(Hasher &hasher) const {
+    const std::string &path = heightmap->getPath();
+    hasher.add("TiledHeightmap").add(path.data(), path.size());
+    hasher.add(heightmap->getSize()).add(heightmap->getLevels()).add(heightmap->getTileSize());
+    hasher.add(heightmap->getMinY()).add(heightmap->getMaxY()).add(level);
+}
@@ -0,0 +1,186 @@
+
+#ifndef PROCGEN_TILEDHEIGHTMAP_H
+#define PROCGEN_TILEDHEIGHTMAP_H
+
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "HeightGenerator.h"
+#include "MappedFile.h"
+
+#define TILED_HEIGHTMAP_VERSION 1
+// Tiles start on a boundary of this many bytes, so one tile's pages can be fetched or dropped without touching another
+#define TILED_HEIGHTMAP_ALIGNMENT 4096
+
+/**
+ * An on disk heightmap far bigger than memory, e.g. 32K x 32K. The file holds a mip pyramid of 16 bit heights, each
+ * level a quarter the size of the last, cut into square tiles. A header and an index of where every tile starts come
+ * first, then the tiles level by level and row by row.
+ *
+ * The file is mapped rather than read, so only the tiles that get touched are ever loaded. Reads ask for all their
+ * tiles in the background before copying any, and the least recently used tiles past a budget are dropped, so
+ * resident memory stays the same however big the file is.
+ *
+ * Level n holds every 2^n-th sample of level 0, not an average, so a 2^n+1 chunk read at any level shares its edge
+ * samples with its neighbours exactly. Reading is safe from several threads at once
+ */
+class TiledHeightmap {
+public:
+    /**
+     * Fills one level 0 tile while creating a file
+     * @param samples tileSize * tileSize heights, row by row. Samples past the edge of the map are ignored
+     */
+    typedef std::function<void(int tileX, int tileY, float *samples)> TileSource;
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t size; // Samples along one side of level 0
+        uint32_t tileSize; // Samples along one side of a tile, a power of two
+        uint32_t levels;
+        float minY, maxY; // Range the 16 bit heights are spread over
+        uint32_t reserved;
+        uint64_t indexOffset; // Where the index starts, one uint64_t offset per tile, level by level
+    };
+
+    MappedFile file;
+    std::string path;
+    bool valid = false;
+    Header header{};
+    const uint64_t *index = nullptr;
+    std::vector<unsigned int> levelSizes;
+    std::vector<unsigned int> levelTiles; // Tiles along one side
+    std::vector<size_t> levelFirstTile; // Position of the level's first tile in the index
+
+    // Tiles touched, most recent first, and where each one is in the list
+    mutable std::mutex mutex;
+    mutable std::list<size_t> recentTiles;
+    mutable std::unordered_map<size_t, std::list<size_t>::iterator> residentTiles;
+    size_t tileBudget = 256;
+
+    size_t getTileBytes() const;
+
+    /**
+     * @return Position of a tile in the index
+     */
+    size_t getTile(int level, int tileX, int tileY) const;
+
+    const uint16_t *getTileData(size_t tile) const;
+
+    /**
+     * Marks tiles as just used, dropping the least recently used ones past the budget
+     */
+    void touch(const std::vector<size_t> &tiles) const;
+
+    /**
+     * Works out level sizes and tile counts from the header
+     */
+    static void layout(const Header &header, std::vector<unsigned int> &levelSizes,
+                       std::vector<unsigned int> &levelTiles, std::vector<size_t> &levelFirstTile);
+
+public:
+    /**
+     * Maps a file, check isOpen to see if it worked
+     */
+    explicit TiledHeightmap(const std::string &path);
+
+    bool isOpen() const;
+
+    const std::string &getPath() const;
+
+    /**
+     * @return Samples along one side of a level
+     */
+    unsigned int getSize(int level = 0) const;
+
+    unsigned int getLevels() const;
+
+    unsigned int getTileSize() const;
+
+    float getMinY() const;
+
+    float getMaxY() const;
+
+    /**
+     * Height at a sample of a level, clamped to the edges
+     */
+    float sample(int level, int x, int y) const;
+
+    /**
+     * Fills the field with a level's samples starting at (x, y), clamped to the edges
+     */
+    void read(int level, int x, int y, HeightField &field) const;
+
+    /**
+     * Starts loading the tiles under [x0, x1) x [y0, y1) of a level in the background, e.g. just ahead of the camera
+     */
+    void prefetch(int level, int x0, int y0, int x1, int y1) const;
+
+    /**
+     * Sets how many tiles can stay loaded before the least recently used are dropped
+     */
+    void setTileBudget(size_t tiles);
+
+    /**
+     * @return Tiles currently counted against the budget
+     */
+    size_t getResidentTiles() const;
+
+    /**
+     * Writes a new file. Level 0 comes from the source a tile at a time, row by row, and every other level from the
+     * one below it read back from the file, so memory use here only depends on the tile size
+     * @param size Samples along one side of level 0
+     * @param tileSize Samples along one side of a tile, a power of two of at least 64
+     * @param minY Heights are clamped to [minY, maxY] and stored as 16 bits over that range
+     * @return False if the file couldn't be written
+     */
+    static bool create(const std::string &path, unsigned int size, unsigned int tileSize, float minY, float maxY,
+                       const TileSource &source);
+
+    /**
+     * Writes a new file from a generator, generating tiles in parallel. The generator has to line up fields at
+     * neighbouring origins, e.g. noise or seamless diamond-square.
+     * A whole row of tiles is generated at once so every thread has a tile to work on, which keeps a row of tiles in
+     * memory on top of what the source version uses: size rounded up to whole tiles times tileSize floats, about 67 MB
+     * at 65537 with 256 tiles
+     */
+    static bool create(const std::string &path, unsigned int size, unsigned int tileSize, float minY, float maxY,
+                       const HeightGenerator &generator);
+
+    /**
+     * Converts a raw heightmap of little endian 16 bit samples, row by row, the usual .r16/.raw export
+     * @param minY Height of a 0 sample
+     * @param maxY Height of a 65535 sample
+     */
+    static bool importRaw16(const std::string &rawPath, unsigned int size, const std::string &path,
+                            unsigned int tileSize, float minY, float maxY);
+};
+
+/**
+ * Streams heights out of a tiled heightmap for anything that takes a generator, like ChunkManager. Origins are in
+ * samples of the chosen level
+ */
+class TiledHeightmapSource : public HeightGenerator {
+private:
+    std::shared_ptr<const TiledHeightmap> heightmap;
+    int level;
+
+public:
+    explicit TiledHeightmapSource(std::shared_ptr<const TiledHeightmap> heightmap, int level = 0);
+
+    void generate(HeightField &field, int originX = 0, int originY = 0) const override;
+
+    float getHeightScale() const override;
+
+    void hash(Hasher &hasher) const override;
+};
+
+
+#endif //PROCGEN_TILEDHEIGHTMAP_H
@@ -3,42 +3,16 @@
 #define PROCGEN_TREE_H
 
 
-#include <vec3.hpp>
-#include <vector>
-#include <list>
+#include "Frustum.h"
 #include "Shader.h"
+#include "TreeSkeleton.h"
 
-struct TreeSettings {
-    glm::vec3 crownCentre;
-    glm::vec3 crownSize;
-    unsigned int attractionPoints;
-    float influenceRadius; // di
-    float killDistance; // dk
-    float nodeSize;
-};
-
-// Branches
-struct Node {
-    Node *parent;
-    glm::vec3 position;
-    glm::vec3 direction;
-    int influenceCount;
-};
-
-// "leaves"
-struct AttractionPoint {
-    glm::vec3 position;
-    Node *closestNode;
-
-};
-
+/**
+ * Draws a tree skeleton as lines
+ */
 class Tree {
 private:
-    glm::vec3 position;
-
-    TreeSettings settings;
-    std::list<AttractionPoint> attractionPoints;
-    std::vector<Node *> nodes;
+    TreeSkeleton skeleton;
 
     // Render
     Shader *shader;
@@ -47,13 +21,19 @@ private:
     GLuint vbo;
     GLuint indices;
     glm::mat4 model;
-
-    void grow();
+    BoundingBox bounds; // Around every node, world space
 
     void buildBuffers();
 public:
     Tree(TreeSettings &settings, glm::vec3 origin, Shader *shader);
 
+    /**
+     * Draws a skeleton that has already been grown, e.g. on another thread
+     */
+    Tree(TreeSkeleton skeleton, Shader *shader);
+
+    const BoundingBox &getBounds() const;
+
     void render();
 };
 
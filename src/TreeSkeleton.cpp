@@ -0,0 +1,135 @@
+
+#include <fstream>
+#include <geometric.hpp>
+#include <iostream>
+#include "Random.h"
+#include "TreeSkeleton.h"
+
+TreeSkeleton::TreeSkeleton(const TreeSettings &settings, glm::vec3 origin) : settings(settings), origin(origin) {
+    // Generate attraction points. Each axis is its own stream, indexed by the point
+    glm::vec3 crownSizeHalf = settings.crownSize / 2.f;
+    Random random(settings.seed);
+
+    for (unsigned int i = 0; i < settings.attractionPoints; ++i) {
+        auto pos = glm::vec3(settings.crownCentre);
+        pos.x += random.uniform(0, i, -crownSizeHalf.x, crownSizeHalf.x);
+        pos.y += random.uniform(1, i, -crownSizeHalf.y, crownSizeHalf.y);
+        pos.z += random.uniform(2, i, -crownSizeHalf.z, crownSizeHalf.z);
+
+        AttractionPoint point{};
+        point.position = pos;
+        attractionPoints.push_back(point);
+    }
+
+    // Create root node
+    Node rootNode{};
+    rootNode.parent = -1;
+    rootNode.lastChild = -1;
+    rootNode.position = origin;
+    rootNode.direction = glm::vec3(0.f, 1.f, 0.f);
+    nodes.push_back(rootNode);
+
+    // Points out of reach of every branch would never be reached, so stop once nothing grows
+    while (!attractionPoints.empty() && grow()) {
+    }
+}
+
+bool TreeSkeleton::grow() {
+    for (auto point = attractionPoints.begin(); point != attractionPoints.end();) {
+        point->closestNode = -1;
+
+        bool reached = false;
+        for (int i = 0; i < static_cast<int>(nodes.size()); ++i) {
+            auto distance = glm::distance(point->position, nodes[i].position);
+            if (distance < settings.killDistance) {
+                reached = true;
+                break;
+            }
+            else if (distance < settings.influenceRadius) {
+                // Check if we're now the closest point and if so, set it
+                if (point->closestNode == -1 ||
+                    distance < glm::distance(nodes[point->closestNode].position, point->position)) {
+                    point->closestNode = i;
+                }
+            }
+        }
+
+        // Remove the point as a branch has now reached it
+        if (reached) {
+            point = attractionPoints.erase(point);
+            continue;
+        }
+
+        // Move node towards point
+        if (point->closestNode != -1) {
+            auto &closest = nodes[point->closestNode];
+            closest.direction += glm::normalize(point->position - closest.position);
+            closest.influenceCount += 1;
+        }
+        ++point;
+    }
+
+    // Generate new nodes
+    auto count = static_cast<int>(nodes.size());
+    for (int i = 0; i < count; ++i) {
+        // A copy, adding to the vector can move the node
+        Node node = nodes[i];
+        if (node.influenceCount > 0) {
+            Node newNode{};
+            newNode.parent = i;
+            newNode.lastChild = -1;
+            newNode.direction = glm::normalize(node.direction / static_cast<float>(node.influenceCount));
+            newNode.position = node.position + newNode.direction * settings.nodeSize;
+
+            // Only grow again if something still pulls on it, otherwise a point out of every branch's reach would
+            // keep the node sprouting forever
+            nodes[i].direction = newNode.direction;
+            nodes[i].influenceCount = 0;
+
+            // Points pulling from opposite sides can leave the node closer to them than its branch, which would then
+            // grow the same branch again every step
+            if (node.lastChild != -1 &&
+                glm::distance(nodes[node.lastChild].position, newNode.position) < settings.nodeSize * .01f) {
+                continue;
+            }
+            nodes[i].lastChild = static_cast<int>(nodes.size());
+            nodes.push_back(newNode);
+        }
+    }
+    return static_cast<int>(nodes.size()) > count;
+}
+
+const std::vector<Node> &TreeSkeleton::getNodes() const {
+    return nodes;
+}
+
+const glm::vec3 &TreeSkeleton::getOrigin() const {
+    return origin;
+}
+
+BoundingBox TreeSkeleton::getBounds() const {
+    BoundingBox bounds{nodes[0].position, nodes[0].position};
+    for (auto &node : nodes) {
+        bounds.min = glm::min(bounds.min, node.position);
+        bounds.max = glm::max(bounds.max, node.position);
+    }
+    return bounds;
+}
+
+bool TreeSkeleton::saveObj(const std::string &path) const {
+    std::ofstream out(path);
+    for (auto &node : nodes) {
+        out << "v " << node.position.x << ' ' << node.position.y << ' ' << node.position.z << '\n';
+    }
+    // OBJ counts vertices from 1
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].parent != -1) {
+            out << "l " << nodes[i].parent + 1 << ' ' << i + 1 << '\n';
+        }
+    }
+    if (!out) {
+        std::cerr << "Failed to write tree " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+
+#ifndef PROCGEN_TREESKELETON_H
+#define PROCGEN_TREESKELETON_H
+
+
+#include <list>
+#include <string>
+#include <vec3.hpp>
+#include <vector>
+#include "Frustum.h"
+
+struct TreeSettings {
+    glm::vec3 crownCentre;
+    glm::vec3 crownSize;
+    unsigned int attractionPoints;
+    float influenceRadius; // di
+    float killDistance; // dk
+    float nodeSize;
+    unsigned int seed;
+};
+
+// Branches
+struct Node {
+    int parent; // Index in the skeleton's nodes, -1 for the root
+    int lastChild; // The branch it grew most recently, -1 before it has grown one
+    glm::vec3 position;
+    glm::vec3 direction;
+    int influenceCount;
+};
+
+// "leaves"
+struct AttractionPoint {
+    glm::vec3 position;
+    int closestNode;
+};
+
+/**
+ * The branches of a tree grown by space colonisation, without anything to draw them, so trees can be grown on any
+ * thread or without a window at all. See Tree for drawing one
+ */
+class TreeSkeleton {
+private:
+    TreeSettings settings;
+    glm::vec3 origin;
+    std::list<AttractionPoint> attractionPoints;
+    std::vector<Node> nodes;
+
+    /**
+     * @return False if no branch grew, in which case it never will
+     */
+    bool grow();
+
+public:
+    /**
+     * Grows the whole tree
+     * @param origin Where the root node sits
+     */
+    TreeSkeleton(const TreeSettings &settings, glm::vec3 origin);
+
+    const std::vector<Node> &getNodes() const;
+
+    const glm::vec3 &getOrigin() const;
+
+    /**
+     * @return Bounds around every node
+     */
+    BoundingBox getBounds() const;
+
+    /**
+     * Writes the branches as an OBJ file of line segments, a vertex per node, which most 3D tools can open
+     * @return False if the file couldn't be written
+     */
+    bool saveObj(const std::string &path) const;
+};
+
+
+#endif //PROCGEN_TREESKELETON_H
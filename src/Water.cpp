@@ -1,10 +1,23 @@
 
 #include "Water.h"
 #include <GLFW/glfw3.h>
+#include "DiamondSquare.h"
 
-Water::Water(unsigned short size, float maxRand, float h, Shader *shader, Material &material) : Terrain(size, maxRand,
-                                                                                                        h, shader,
-                                                                                                        material) {}
+// Matches the wave amplitude in water_vert.glsl
+#define WAVE_HEIGHT .05f
+
+Water::Water(unsigned short size, float maxRand, float h, unsigned int seed, Shader *shader, Material &material)
+        : Terrain(size, DiamondSquare(seed, maxRand, h), shader, material) {}
+
+Water::Water(unsigned short size, const HeightGenerator &generator, Shader *shader, Material &material)
+        : Terrain(size, generator, shader, material) {}
+
+BoundingBox Water::getBounds() const {
+    auto bounds = Terrain::getBounds();
+    bounds.min.y -= WAVE_HEIGHT;
+    bounds.max.y += WAVE_HEIGHT;
+    return bounds;
+}
 
 void Water::render() {
     shader->use();
@@ -7,7 +7,17 @@
 
 class Water : public Terrain {
 public:
-    Water(unsigned short size, float maxRand, float h, Shader *shader, Material &material);
+    Water(unsigned short size, float maxRand, float h, unsigned int seed, Shader *shader, Material &material);
+
+    /**
+     * Water with waves from any generator, e.g. a cached one
+     */
+    Water(unsigned short size, const HeightGenerator &generator, Shader *shader, Material &material);
+
+    /**
+     * Terrain bounds with room for the waves the vertex shader adds
+     */
+    BoundingBox getBounds() const override;
 
     void render() override;
 };
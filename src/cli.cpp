@@ -0,0 +1,214 @@
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "DiamondSquare.h"
+#include "HeightFilters.h"
+#include "HeightPipeline.h"
+#include "HydraulicErosion.h"
+#include "NoiseGenerator.h"
+#include "Random.h"
+#include "ThreadPool.h"
+#include "TiledHeightmap.h"
+#include "TreeSkeleton.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+/**
+ * Generates worlds and trees without a window or OpenGL, e.g. on a server. Worlds are generated several at a time
+ * across the thread pool, and each one is written as a tiled heightmap the app can stream (see HEIGHTMAP_PATH), with
+ * its trees as OBJ line skeletons. Without an output directory nothing is written, which just measures throughput.
+ * Usage: ProcGenCli [--seed first] [--count worlds] [--size samples] [--noise] [--erosion] [--filters]
+ *                   [--trees per world] [--out directory]
+ */
+namespace {
+    struct Options {
+        unsigned int seed = 322;
+        int count = 8;
+        unsigned int size = 1025;
+        bool noise = false;
+        bool erosion = false;
+        bool filters = false;
+        int trees = 4;
+        std::string out;
+    };
+
+    void printUsage() {
+        std::cerr << "Usage: ProcGenCli [--seed first] [--count worlds] [--size samples] [--noise] [--erosion] "
+                     "[--filters] [--trees per world] [--out directory]" << std::endl;
+    }
+
+    /**
+     * @return False if the arguments don't make sense, after saying why
+     */
+    bool parseOptions(int argc, char **argv, Options &options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string option = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (option == "--noise") {
+                options.noise = true;
+            } else if (option == "--erosion") {
+                options.erosion = true;
+            } else if (option == "--filters") {
+                options.filters = true;
+            } else if (option == "--seed" && hasValue) {
+                options.seed = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+            } else if (option == "--count" && hasValue) {
+                options.count = atoi(argv[++i]);
+            } else if (option == "--size" && hasValue) {
+                options.size = static_cast<unsigned int>(atoi(argv[++i]));
+            } else if (option == "--trees" && hasValue) {
+                options.trees = atoi(argv[++i]);
+            } else if (option == "--out" && hasValue) {
+                options.out = argv[++i];
+            } else {
+                std::cerr << "Unknown option or missing value: " << option << std::endl;
+                return false;
+            }
+        }
+
+        unsigned int span = options.size - 1;
+        if (options.size < 3 || (span & (span - 1)) != 0) {
+            std::cerr << "Worlds have to be 2^n+1 samples along a side, not " << options.size << std::endl;
+            return false;
+        }
+        if (options.count < 1 || options.trees < 0) {
+            std::cerr << "Need at least one world and no fewer than zero trees" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * The same generators and passes as the app
+     */
+    std::shared_ptr<const HeightGenerator> makeGenerator(const Options &options, unsigned int seed) {
+        std::shared_ptr<HeightGenerator> generator;
+        if (options.noise) {
+            NoiseSettings noiseSettings;
+            noiseSettings.mode = NoiseMode::Ridged;
+            generator = std::make_shared<NoiseGenerator>(seed, noiseSettings);
+        } else {
+            auto diamondSquare = std::make_shared<DiamondSquare>(seed, 7.f, 1.f);
+            diamondSquare->setEdgeMode(EdgeMode::Seamless);
+            generator = diamondSquare;
+        }
+        auto pipeline = std::make_shared<HeightPipeline>(generator);
+        if (options.erosion) {
+            pipeline->addPass(std::make_shared<HydraulicErosion>(seed));
+        }
+        if (options.filters) {
+            auto filters = std::make_shared<FilterChain>();
+            filters->addThermal(8, .6f);
+            filters->addBlur(.8f);
+            pipeline->addPass(filters);
+        }
+        return pipeline;
+    }
+
+    /**
+     * Grows a tree at a random spot on the world, standing on the ground
+     */
+    TreeSkeleton growTree(const HeightField &field, unsigned int seed, int tree) {
+        Random random(seed);
+        int x = static_cast<int>(random.next(0, tree) % field.getSize());
+        int z = static_cast<int>(random.next(1, tree) % field.getSize());
+        glm::vec3 origin(static_cast<float>(x), field.at(x, z), static_cast<float>(z));
+
+        TreeSettings settings{};
+        settings.attractionPoints = 1000;
+        settings.influenceRadius = 2.f;
+        settings.killDistance = .5f;
+        settings.crownCentre = origin + glm::vec3(0.f, 2.5f, 0.f);
+        settings.crownSize = glm::vec3(2.f, 5.f, 2.f);
+        settings.nodeSize = .25f;
+        settings.seed = random.next(2, tree);
+        return TreeSkeleton(settings, origin);
+    }
+
+    /**
+     * Writes the heights as a tiled heightmap over their own range
+     */
+    bool writeHeightmap(const std::string &path, const HeightField &field) {
+        int size = static_cast<int>(field.getSize());
+        unsigned int tileSize = 64;
+        while (tileSize < 256 && static_cast<int>(tileSize) < size - 1) {
+            tileSize *= 2;
+        }
+        float minY, maxY;
+        field.getRange(minY, maxY);
+        maxY = std::max(maxY, minY + 1e-3f);
+        auto source = [&](int tileX, int tileY, float *samples) {
+            int x0 = tileX * static_cast<int>(tileSize), y0 = tileY * static_cast<int>(tileSize);
+            int width = std::min(static_cast<int>(tileSize), size - x0);
+            int height = std::min(static_cast<int>(tileSize), size - y0);
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    samples[static_cast<size_t>(y) * tileSize + x] = field.at(x0 + x, y0 + y);
+                }
+            }
+        };
+        return TiledHeightmap::create(path, field.getSize(), tileSize, minY, maxY, source);
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+    if (!options.out.empty()) {
+#ifdef _WIN32
+        _mkdir(options.out.c_str());
+#else
+        mkdir(options.out.c_str(), 0755);
+#endif
+    }
+
+    auto &pool = ThreadPool::global();
+    std::atomic<size_t> branches{0};
+    std::atomic<int> failures{0};
+    auto start = std::chrono::steady_clock::now();
+    // A world at a time per thread keeps every core busy even for small worlds, whose own levels are too short to
+    // split up well. Anything a world splits up itself still goes across the pool as the caller takes part
+    pool.parallelFor(0, options.count, [&](int world) {
+        unsigned int seed = options.seed + static_cast<unsigned int>(world);
+        HeightField field(options.size);
+        makeGenerator(options, seed)->generate(field);
+        std::string name = options.out + "/world_" + std::to_string(seed);
+        if (!options.out.empty() && !writeHeightmap(name + ".pgtm", field)) {
+            ++failures;
+        }
+
+        pool.parallelFor(0, options.trees, [&](int tree) {
+            TreeSkeleton skeleton = growTree(field, seed, tree);
+            branches += skeleton.getNodes().size() - 1;
+            if (!options.out.empty() && !skeleton.saveObj(name + "_tree_" + std::to_string(tree) + ".obj")) {
+                ++failures;
+            }
+        });
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double samples = static_cast<double>(options.size) * options.size * options.count;
+    int trees = options.trees * options.count;
+    printf("%d worlds of %ux%u and %d trees (%zu branches) in %.2f s on %u threads\n", options.count, options.size,
+           options.size, trees, branches.load(), seconds, pool.getThreadCount());
+    printf("%.2f worlds/s, %.1f M samples/s, %.1f trees/s\n", options.count / seconds, samples / seconds / 1e6,
+           trees / seconds);
+    if (failures > 0) {
+        std::cerr << failures << " files couldn't be written" << std::endl;
+        return 1;
+    }
+    return 0;
+}
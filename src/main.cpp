@@ -15,13 +15,60 @@
 #include "glHelper.h"
 #include "Water.h"
 #include "Tree.h"
+#include "ChunkManager.h"
+#include "CdlodTerrain.h"
+#include "ProgressiveTerrain.h"
+#include "DiamondSquare.h"
+#include "Frustum.h"
+#include "NoiseGenerator.h"
+#include "HeightPipeline.h"
+#include "HydraulicErosion.h"
+#include "HeightFilters.h"
+#include "HeightCache.h"
+#include "TiledHeightmap.h"
 
 // REMEMBER ITS TO THE POWER OF 2, NOT DIVISIBLE BY 2 (2^n+1)
 #define MAP_SIZE 33
+#define WORLD_SEED 322
+// Chunks also have to be 2^n+1
+#define CHUNK_SIZE 65
+#define VIEW_DISTANCE 4
+#define CHUNK_UPLOAD_BUDGET 2
+// Set to 1 to draw one large map with CDLOD instead of streaming chunks
+#define USE_CDLOD 0
+#define CDLOD_MAP_SIZE 4097
+// Set to 1 to draw one large diamond-square map that shows a coarse version on the first frame and sharpens as the
+// finer levels are generated in the background. Passes and the height cache don't apply to it
+#define USE_PROGRESSIVE 0
+#define PROGRESSIVE_MAP_SIZE 2049
+// Samples along one side of the version shown first, also 2^n+1
+#define PROGRESSIVE_FIRST_SIZE 129
+// Set to 1 to generate with fractal simplex noise instead of diamond-square
+#define USE_NOISE 0
+// Set to 1 to run hydraulic erosion over the heights before building meshes. Chunks are eroded on their own, their
+// edges are left alone so they still line up
+#define USE_EROSION 0
+// Set to 1 to slump cliffs with thermal erosion, smooth the result and flatten the sea bed under the water
+#define USE_FILTERS 0
+#define WATER_LEVEL -3.25f
+// Set to a directory to keep generated heights there and load them on later launches instead of generating them again.
+// Worth it when erosion or filters are on. Every chunk at every origin is its own file and nothing is ever deleted,
+// so exploring keeps adding to it
+#define HEIGHT_CACHE_DIRECTORY ""
+// Set to a tiled heightmap file to stream the chunks out of it instead of generating them
+#define HEIGHTMAP_PATH ""
+#define HEIGHTMAP_TILE_BUDGET 64
+
+#if USE_PROGRESSIVE && USE_NOISE
+#error "Progressive refinement relies on diamond-square's levels, turn off USE_NOISE"
+#endif
 
 Camera camera;
 std::vector<Shader *> shaders;
 Tree *tree;
+ChunkManager *chunkManager;
+CdlodTerrain *cdlodTerrain;
+ProgressiveTerrain *progressiveTerrain;
 
 const Light light {
     glm::vec3(2.5f, 10.f, 2.5f),
@@ -74,8 +121,13 @@ GLuint loadTexture(const char *filePath) {
 }
 
 void generateTerrain(std::vector<Terrain *> &terrains) {
+    std::shared_ptr<HeightCache> heightCache;
+    if (HEIGHT_CACHE_DIRECTORY[0] != '\0') {
+        heightCache = std::make_shared<HeightCache>(HEIGHT_CACHE_DIRECTORY);
+    }
+
     // Main terrain
-    auto shader = new Shader("assets/shaders/vert.glsl", "assets/shaders/terrain_frag.glsl");
+    auto shader = new Shader("assets/shaders/vert.glsl", "assets/shaders/terrain_frag.glsl", TERRAIN_SHADER_DEFINES);
     shader->setLight(light);
     shaders.push_back(shader);
     GLERRCHECK();
@@ -89,12 +141,55 @@ void generateTerrain(std::vector<Terrain *> &terrains) {
                 loadTexture("assets/textures/grass.jpg")
             }
     };
-    terrains.push_back(new Terrain(MAP_SIZE, 7.f, 1.f, shader, material));
+#if USE_NOISE
+    NoiseSettings noiseSettings;
+    noiseSettings.mode = NoiseMode::Ridged;
+    auto generator = std::make_shared<NoiseGenerator>(WORLD_SEED, noiseSettings);
+#else
+    auto generator = std::make_shared<DiamondSquare>(WORLD_SEED, 7.f, 1.f);
+    generator->setEdgeMode(EdgeMode::Seamless);
+#endif
+    auto pipeline = std::make_shared<HeightPipeline>(generator);
+#if USE_EROSION
+    pipeline->addPass(std::make_shared<HydraulicErosion>(WORLD_SEED));
+#endif
+#if USE_FILTERS
+    auto filters = std::make_shared<FilterChain>();
+    filters->addThermal(8, .6f);
+    filters->addBlur(.8f);
+    filters->addClamp(WATER_LEVEL - 1.f, generator->getHeightScale() * 2.f);
+    pipeline->addPass(filters);
+#endif
+    std::shared_ptr<const HeightGenerator> heightGenerator = pipeline;
+    if (heightCache) {
+        heightGenerator = std::make_shared<CachedGenerator>(heightGenerator, heightCache);
+    }
+    if (HEIGHTMAP_PATH[0] != '\0') {
+        auto heightmap = std::make_shared<TiledHeightmap>(HEIGHTMAP_PATH);
+        if (heightmap->isOpen()) {
+            heightmap->setTileBudget(HEIGHTMAP_TILE_BUDGET);
+            heightGenerator = std::make_shared<TiledHeightmapSource>(heightmap);
+        }
+    }
+#if USE_CDLOD
+    auto cdlodShader = new Shader("assets/shaders/cdlod_vert.glsl", "assets/shaders/terrain_frag.glsl");
+    cdlodShader->setLight(light);
+    shaders.push_back(cdlodShader);
+    HeightField heightField(CDLOD_MAP_SIZE);
+    heightGenerator->generate(heightField);
+    cdlodTerrain = new CdlodTerrain(std::move(heightField), cdlodShader, material);
+#elif USE_PROGRESSIVE
+    progressiveTerrain = new ProgressiveTerrain(generator, PROGRESSIVE_MAP_SIZE, PROGRESSIVE_FIRST_SIZE, shader,
+                                                material);
+#else
+    chunkManager = new ChunkManager(CHUNK_SIZE, heightGenerator, VIEW_DISTANCE, CHUNK_UPLOAD_BUDGET, shader, material);
+#endif
     GLERRCHECK();
 
     // Water
     // Main terrain
-    auto waterShader = new Shader("assets/shaders/water_vert.glsl", "assets/shaders/water_frag.glsl");
+    auto waterShader = new Shader("assets/shaders/water_vert.glsl", "assets/shaders/water_frag.glsl",
+                                  TERRAIN_SHADER_DEFINES);
     waterShader->setLight(light);
     shaders.push_back(waterShader);
     GLERRCHECK();
@@ -107,8 +202,12 @@ void generateTerrain(std::vector<Terrain *> &terrains) {
                     loadTexture("assets/textures/water.jpg")
             }
     };
-    auto water = new Water(MAP_SIZE, 1.f, .8f, waterShader, waterMaterial);
-    water->setPosition(glm::vec3(0.f, -3.25f, 0.f));
+    std::shared_ptr<const HeightGenerator> waves = std::make_shared<DiamondSquare>(WORLD_SEED + 1, 1.f, .8f);
+    if (heightCache) {
+        waves = std::make_shared<CachedGenerator>(waves, heightCache);
+    }
+    auto water = new Water(MAP_SIZE, *waves, waterShader, waterMaterial);
+    water->setPosition(glm::vec3(0.f, WATER_LEVEL, 0.f));
     terrains.push_back(water);
     GLERRCHECK();
 }
@@ -125,6 +224,7 @@ void generateTree() {
     settings.crownCentre = glm::vec3(0.f, 2.5f, 0.f);
     settings.crownSize = glm::vec3(2.f, 5.f, 2.f);
     settings.nodeSize = .25f;
+    settings.seed = WORLD_SEED;
 
     tree = new Tree(settings, glm::vec3(0.f), shader);
 }
@@ -204,21 +304,59 @@ int main() {
         GLERRCHECK();
     }
 
+    double lastTitleUpdate = glfwGetTime();
     while (!glfwWindowShouldClose(window)) {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         skybox->render(camera);
         GLERRCHECK();
 
+        Frustum frustum(camera.getProjMatrix() * camera.getViewMatrix());
+        CullStats cullStats;
+#if USE_CDLOD
+        cdlodTerrain->render(camera);
+        cullStats = cdlodTerrain->getCullStats();
+#elif USE_PROGRESSIVE
+        progressiveTerrain->update();
+        ++cullStats.tested;
+        if (frustum.isVisible(progressiveTerrain->getBounds())) {
+            progressiveTerrain->render();
+        } else {
+            ++cullStats.culled;
+        }
+#else
+        chunkManager->update(camera);
+        chunkManager->render(frustum);
+        cullStats = chunkManager->getCullStats();
+#endif
+        GLERRCHECK();
+
 //        for (auto mesh : terrain) {
-//            mesh->render();
+//            if (frustum.isVisible(mesh->getBounds())) {
+//                mesh->render();
+//            }
 //            GLERRCHECK();
 //        }
-        tree->render();
+        ++cullStats.tested;
+        if (frustum.isVisible(tree->getBounds())) {
+            tree->render();
+        } else {
+            ++cullStats.culled;
+        }
+
+        // Culling counters in the title, once a second so it's readable
+        if (glfwGetTime() - lastTitleUpdate >= 1.) {
+            std::string title = "322COM ProcGen - culled " + std::to_string(cullStats.culled) + "/" +
+                                std::to_string(cullStats.tested);
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleUpdate = glfwGetTime();
+        }
 
         glfwPollEvents();
         glfwSwapBuffers(window);
     }
 
+    IndexBufferCache::global().clear();
+    glfwTerminate();
     return 0;
 }
\ No newline at end of file